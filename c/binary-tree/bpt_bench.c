@@ -0,0 +1,144 @@
+/**
+ * @file bpt_bench.c
+ * @brief genbplustree vs. a red-black bt_root, same objects in the same
+ * random order: build time, random searches, and a scan of every object.
+ * Usage: ./bpt_bench [#objects ...], 1M and 10M if none given.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "genbinarytree.h"
+#include "genbplustree.h"
+
+#define SEARCHES 1000000
+
+// Objects point into 1 array the bench frees itself.
+static void bench_nofree(void *obj)
+{
+    (void)obj;
+}
+
+static double now_seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// 2 rand() calls, since RAND_MAX may be as low as 32767 and we want 10M.
+static size_t random_below(size_t bound)
+{
+    return ((size_t)rand() * ((size_t)RAND_MAX + 1) + rand()) % bound;
+}
+
+static void shuffle(int *values, size_t count)
+{
+    for (size_t i = count - 1; i > 0; i--)
+    {
+        size_t j = random_below(i + 1);
+        int tmp = values[i];
+        values[i] = values[j];
+        values[j] = tmp;
+    }
+}
+
+// In-order walk of the bt_root, 1 bt_next per object.
+static long long bt_sum(bt_root *root)
+{
+    long long sum = 0;
+    for (bt_branch *node = bt_first(root); node; node = bt_next(node))
+        sum += *(int*)node->obj;
+    return sum;
+}
+
+static bool bpt_sum(void *obj, void *arg)
+{
+    *(long long*)arg += *(int*)obj;
+    return true;
+}
+
+static void report(const char *name, double build, double search,
+                   double scan, size_t count, size_t found, long long sum)
+{
+    // Print <found> and <sum> so the compiler can't throw the work away.
+    printf("    %-12s build %6.0f ms  search %6.1f ns  scan %5.1f ns/obj"
+           "  (found %zu, sum %lld)\n", name, build * 1e3,
+           search * 1e9 / SEARCHES, scan * 1e9 / count, found, sum);
+}
+
+static void bench(size_t count)
+{
+    int *values  = malloc(sizeof(int) * count);
+    int *lookups = malloc(sizeof(int) * SEARCHES);
+    bt_root *bt   = bt_init(NULL, NULL, bench_nofree, BT_REDBLACK);
+    bpt_root *bpt = bpt_init(NULL, NULL, bench_nofree);
+    if (!values || !lookups || !bt || !bpt)
+        goto end_bench;
+
+    for (size_t i = 0; i < count; i++)
+        values[i] = (int)i;
+    shuffle(values, count);
+    for (size_t i = 0; i < SEARCHES; i++)
+        lookups[i] = (int)random_below(count);
+
+    printf("<< %zu objects, %d random searches >>\n", count, SEARCHES);
+
+    double start = now_seconds();
+    for (size_t i = 0; i < count; i++)
+        bt_insert(bt, &values[i]);
+    double build = now_seconds() - start;
+
+    size_t found = 0;
+    start = now_seconds();
+    for (size_t i = 0; i < SEARCHES; i++)
+        found += bt_search(bt, &lookups[i]) != NULL;
+    double search = now_seconds() - start;
+
+    start = now_seconds();
+    long long sum = bt_sum(bt);
+    double scan = now_seconds() - start;
+    report("red-black:", build, search, scan, count, found, sum);
+
+    start = now_seconds();
+    for (size_t i = 0; i < count; i++)
+        bpt_insert(bpt, &values[i]);
+    build = now_seconds() - start;
+
+    found = 0;
+    start = now_seconds();
+    for (size_t i = 0; i < SEARCHES; i++)
+        found += bpt_search(bpt, &lookups[i]) != NULL;
+    search = now_seconds() - start;
+
+    sum = 0;
+    start = now_seconds();
+    bpt_range(bpt, NULL, NULL, bpt_sum, &sum);
+    scan = now_seconds() - start;
+    report("B+ tree:", build, search, scan, count, found, sum);
+    printf("    depth: B+ tree %zu levels\n", bpt->height);
+
+    end_bench:
+    bt_destroy(&bt);
+    bpt_destroy(&bpt);
+    free(values);
+    free(lookups);
+}
+
+int main(int argc, char *argv[])
+{
+    srand(42);
+    if (argc < 2)
+    {
+        bench(1000000);
+        bench(10000000);
+        return EXIT_SUCCESS;
+    }
+    for (int i = 1; i < argc; i++)
+    {
+        size_t count = strtoul(argv[i], NULL, 10);
+        if (count > 0) bench(count);
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,195 @@
+/**
+ * @file bt_bench.c
+ * @brief Sorted vs. random insertion order, for each balancing policy: how
+ * deep the tree gets and how many comparefn calls a search costs.
+ * Then loading an already sorted set: bt_insert 1 by 1 vs. bt_build_sorted.
+ * Usage: ./bt_bench [#objects] [#objects to load] [#threads]
+ * @note BT_PLAIN with sorted keys is n^2 / 2 comparisons to build, so keep
+ * #objects modest.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "genbinarytree.h"
+
+static size_t compares = 0;
+
+// Same as the default int compare, but counts how often it's called.
+static int bench_cmpfn(void *parent, void *child)
+{
+    int x = *(int*)parent;
+    int y = *(int*)child;
+
+    compares++;
+    if (x > y)
+        return IS_LCHILD;
+    else if (x < y)
+        return IS_RCHILD;
+    return BOTH_SAME;
+}
+
+// Objects point into 1 array the bench frees itself.
+static void bench_nofree(void *obj)
+{
+    (void)obj;
+}
+
+static double now_seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static size_t depth(bt_branch *node)
+{
+    if (!node) return 0;
+
+    size_t ldepth = depth(node->lchild);
+    size_t rdepth = depth(node->rchild);
+    return 1 + ((ldepth > rdepth) ? ldepth : rdepth);
+}
+
+static void shuffle(int *values, size_t count)
+{
+    for (size_t i = count - 1; i > 0; i--)
+    {
+        size_t j = (size_t)rand() % (i + 1);
+        int tmp = values[i];
+        values[i] = values[j];
+        values[j] = tmp;
+    }
+}
+
+/**
+ * @brief Insert <order>, search for every key, then remove them all.
+ * @param lookups The same keys in another order, for searching and removing.
+ */
+static void bench_one(const char *name, int balance, int *order, int *lookups,
+                      size_t count)
+{
+    bt_root *tree = bt_init(bench_cmpfn, NULL, bench_nofree, balance);
+    if (!tree) return;
+
+    double start = now_seconds();
+    for (size_t i = 0; i < count; i++)
+        bt_insert(tree, &order[i]);
+    double insert_time = now_seconds() - start;
+    size_t tree_depth = depth(tree->branch);
+
+    compares = 0;
+    size_t found = 0;
+    for (size_t i = 0; i < count; i++)
+        found += bt_search(tree, &lookups[i]) != NULL;
+    double per_search = (double)compares / count;
+
+    start = now_seconds();
+    size_t removed = 0;
+    for (size_t i = 0; i < count; i++)
+        removed += bt_remove(tree, &lookups[i]);
+    double remove_time = now_seconds() - start;
+
+    printf("    %-22s depth %6zu  %7.1f cmp/search  "
+           "insert %7.1f ms  remove %7.1f ms%s\n",
+           name, tree_depth, per_search, insert_time * 1e3, remove_time * 1e3,
+           (found != count || removed != count || tree->branch) ? "  (lost some!)" : "");
+    bt_destroy(&tree);
+}
+
+static void report_load(const char *name, double elapsed, bt_root *tree)
+{
+    if (!tree) return;
+    printf("    %-30s %8.1f ms  depth %3zu  (%zu nodes)\n", name, elapsed * 1e3,
+           depth(tree->branch), tree->nodecount);
+}
+
+// The startup case: a big set that's already in order, into a red-black tree.
+static void bench_load(size_t count, int nthreads)
+{
+    int *values = malloc(sizeof(int) * count);
+    void **objs = malloc(sizeof(void*) * count);
+    if (!values || !objs)
+    {
+        free(values);
+        free(objs);
+        return;
+    }
+    for (size_t i = 0; i < count; i++)
+    {
+        values[i] = (int)i;
+        objs[i] = &values[i];
+    }
+
+    printf("<< loading %zu sorted objects, red-black >>\n", count);
+    bt_root *tree = bt_init(NULL, NULL, bench_nofree, BT_REDBLACK);
+    double start = now_seconds();
+    for (size_t i = 0; i < count; i++)
+        bt_insert(tree, objs[i]);
+    report_load("bt_insert 1 by 1:", now_seconds() - start, tree);
+    bt_destroy(&tree);
+
+    tree = bt_init(NULL, NULL, bench_nofree, BT_REDBLACK);
+    start = now_seconds();
+    bt_build_sorted(tree, objs, count);
+    report_load("bt_build_sorted:", now_seconds() - start, tree);
+    bt_destroy(&tree);
+
+    char name[48];
+    snprintf(name, sizeof(name), "bt_build_sorted_parallel(%i):", nthreads);
+    tree = bt_init(NULL, NULL, bench_nofree, BT_REDBLACK);
+    start = now_seconds();
+    bt_build_sorted_parallel(tree, objs, count, nthreads);
+    report_load(name, now_seconds() - start, tree);
+    bt_destroy(&tree);
+
+    free(values);
+    free(objs);
+}
+
+int main(int argc, char *argv[])
+{
+    size_t count = (argc > 1) ? strtoul(argv[1], NULL, 10) : 20000;
+    size_t load  = (argc > 2) ? strtoul(argv[2], NULL, 10) : 1000000;
+    int nthreads = (argc > 3) ? atoi(argv[3])
+                              : (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (count == 0 || load == 0 || nthreads <= 0) return EXIT_FAILURE;
+
+    int *sorted  = malloc(sizeof(int) * count);
+    int *random  = malloc(sizeof(int) * count);
+    int *lookups = malloc(sizeof(int) * count);
+    if (!sorted || !random || !lookups)
+    {
+        free(sorted);
+        free(random);
+        free(lookups);
+        return EXIT_FAILURE;
+    }
+
+    srand(42);
+    for (size_t i = 0; i < count; i++)
+        sorted[i] = random[i] = lookups[i] = (int)i;
+    shuffle(random, count);
+    shuffle(lookups, count);
+
+    printf("<< %zu objects, log2(n) = %.1f >>\n", count, log2((double)count));
+    const char *names[] = { "plain", "red-black", "AVL" };
+    const int policies[] = { BT_PLAIN, BT_REDBLACK, BT_AVL };
+    for (int p = 0; p < 3; p++)
+    {
+        char name[32];
+        snprintf(name, sizeof(name), "%s, sorted:", names[p]);
+        bench_one(name, policies[p], sorted, lookups, count);
+        snprintf(name, sizeof(name), "%s, random:", names[p]);
+        bench_one(name, policies[p], random, lookups, count);
+    }
+    bench_load(load, nthreads);
+
+    free(sorted);
+    free(random);
+    free(lookups);
+    return EXIT_SUCCESS;
+}
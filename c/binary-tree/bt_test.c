@@ -26,9 +26,22 @@ int testarray[] =
 
 const int testlen = ARRAYLENGTH(testarray);
 
+// For the 2nd tree, which only borrows the 1st tree's objects.
+void btree_nofree(void *obj)
+{
+    (void)obj;
+}
+
+bool btree_visit(void *obj, void *arg)
+{
+    (void)arg;
+    btree_print(obj);
+    return true;
+}
+
 int main(void)
 {
-    bt_root *btree = bt_init(NULL, btree_print, NULL);
+    bt_root *btree = bt_init(NULL, btree_print, NULL, BT_PLAIN);
     if (!btree) return EXIT_FAILURE;
 
     for (int i = 0; i < testlen; i++)
@@ -46,6 +59,36 @@ int main(void)
     bt_printbt(btree);
     printf("\n");
 
+    printf("<< IN ORDER, SMALLEST FIRST >>\n");
+    for (bt_branch *node = bt_first(btree); node; node = bt_next(node))
+        btree_print(node->obj);
+    printf("\n");
+
+    printf("<< IN ORDER, LARGEST FIRST >>\n");
+    for (bt_branch *node = bt_last(btree); node; node = bt_prev(node))
+        btree_print(node->obj);
+    printf("\n");
+
+    int lo = 10, hi = 20;
+    printf("<< RANGE %i TO %i >>\n", lo, hi);
+    bt_range(btree, &lo, &hi, btree_visit, NULL);
+    printf("\n");
+
+    // Same objects, in order, built straight into a balanced tree.
+    void *sorted[ARRAYLENGTH(testarray)];
+    size_t count = 0;
+    for (bt_branch *node = bt_first(btree); node; node = bt_next(node))
+        sorted[count++] = node->obj;
+
+    bt_root *balanced = bt_init(NULL, btree_print, btree_nofree, BT_PLAIN);
+    if (balanced && bt_build_sorted(balanced, sorted, count))
+    {
+        printf("<< TREE PRINTOUT 2, BUILT FROM SORTED >>\n");
+        bt_printbt(balanced);
+        printf("\n");
+    }
+    bt_destroy(&balanced);
+
     bt_destroy(&btree);
 
     return EXIT_SUCCESS;
@@ -1,4 +1,6 @@
+#include <pthread.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <stdio.h>
 
@@ -12,14 +14,25 @@
 
 static bt_branch *bt_lookup(bt_root *root, void *obj);
 static int bt_cmpfn(void *parent, void *child);
-static void bt_destroy_recurse(free_obj *freefn, bt_branch *node);
+static void bt_destroy_recurse(bt_root *root, bt_branch *node);
+static void bt_free_node(bt_root *root, bt_branch *node);
+static bool bt_build(bt_root *root, void **objs, size_t n, int nthreads);
 static void bt_printfn(void *obj);
 static void bt_print_recurse(int recurse, printobj *objprintfn, bt_branch *node);
 static void bt_errorprint(int errcode, printobj *printfn, bt_branch *parent, void *obj);
-static void reassign_children(int cmp, bt_branch *parent, bt_branch *target);
-
-bt_root *bt_init(cmp_obj *cmpfn, printobj *printfn, free_obj *freefn)
+static void bt_replace(bt_root *root, bt_branch *target, bt_branch *child);
+static void bt_rotate_left(bt_root *root, bt_branch *node);
+static void bt_rotate_right(bt_root *root, bt_branch *node);
+static void avl_retrace(bt_root *root, bt_branch *node);
+static void rb_insert_fixup(bt_root *root, bt_branch *node);
+static void rb_remove_fixup(bt_root *root, bt_branch *node, bt_branch *parent);
+
+bt_root *bt_init(cmp_obj *cmpfn, printobj *printfn, free_obj *freefn,
+                 int balance)
 {
+    if (balance != BT_PLAIN && balance != BT_REDBLACK && balance != BT_AVL)
+        return NULL;
+
     bt_root *new_bt = malloc(sizeof(bt_root));
     if (new_bt == NULL) return NULL;
 
@@ -29,6 +42,9 @@ bt_root *bt_init(cmp_obj *cmpfn, printobj *printfn, free_obj *freefn)
     new_bt->printfn   = (printfn) ? printfn : bt_printfn;
     new_bt->freefn    = (freefn)  ? freefn  : free;
     new_bt->nodecount = 0;
+    new_bt->balance   = balance;
+    new_bt->block     = NULL;
+    new_bt->blocklen  = 0;
 
     return new_bt;
 }
@@ -47,6 +63,12 @@ bool bt_insert(bt_root *root, void *obj)
     node->lchild = NULL;
     node->rchild = NULL;
 
+    // New nodes start as leaves: height 1, or red so no black count changes.
+    if (root->balance == BT_AVL)
+        node->height = 1;
+    else
+        node->red = true;
+
     bt_branch *target = root->branch;
 
     if (target == NULL)
@@ -54,6 +76,8 @@ bool bt_insert(bt_root *root, void *obj)
         // If list is empty, <node> is set to be the very first element.
         root->nodecount++;
         root->branch = node;
+        if (root->balance == BT_REDBLACK)
+            rb_insert_fixup(root, node);
         return true;
     }
 
@@ -102,7 +126,13 @@ bool bt_insert(bt_root *root, void *obj)
 
     }
     if (found_spot == true)
+    {
         root->nodecount++;
+        if (root->balance == BT_AVL)
+            avl_retrace(root, node->parent);
+        else if (root->balance == BT_REDBLACK)
+            rb_insert_fixup(root, node);
+    }
     else 
         free(node);
 
@@ -130,6 +160,148 @@ static void bt_errorprint(int errcode, printobj *printfn, bt_branch *parent, voi
     printf("\n");
 }
 
+// What every subtree of 1 bt_build_sorted call shares.
+struct bt_build
+{
+    bt_root *root;
+    void **objs;
+    size_t count;
+    bt_branch *block;       // block[i] holds objs[i], so it's in order too.
+    int red_depth;          // BT_REDBLACK: nodes this deep are red, or -1.
+    bool sorted;            // Cleared if 2 neighbours are out of order.
+};
+
+// 1 subtree to build, in a struct so it can be handed to a thread.
+struct bt_build_job
+{
+    struct bt_build *build;
+    size_t lo;              // objs[lo] up to objs[hi - 1].
+    size_t hi;
+    bt_branch *parent;
+    int depth;
+    int spawn;              // # of levels further down that still get threads.
+    bt_branch *node;        // Out: top of the subtree, <NULL> if empty.
+    int height;             // Out: # of levels in it.
+};
+
+static void bt_build_job_run(struct bt_build_job *job);
+
+static void *bt_build_thread(void *arg)
+{
+    bt_build_job_run(arg);
+    return NULL;
+}
+
+/**
+ * @brief The middle object goes on top, each half builds 1 side below it.
+ * @note The halves differ by 1 at most, so every level but the last is full.
+ */
+static void bt_build_job_run(struct bt_build_job *job)
+{
+    job->node   = NULL;
+    job->height = 0;
+    if (job->lo >= job->hi) return;
+
+    struct bt_build *build = job->build;
+    size_t mid = job->lo + (job->hi - job->lo) / 2;
+    bt_branch *node = &build->block[mid];
+    node->obj    = build->objs[mid];
+    node->parent = job->parent;
+
+    // Every index is somebody's <mid> exactly once, so this checks them all.
+    if (mid + 1 < build->count
+        && build->root->comparefn(build->objs[mid], build->objs[mid + 1]) != IS_RCHILD)
+        __atomic_store_n(&build->sorted, false, __ATOMIC_RELAXED);
+
+    struct bt_build_job left = {
+        .build = build, .lo = job->lo, .hi = mid, .parent = node,
+        .depth = job->depth + 1, .spawn = job->spawn - 1,
+    };
+    struct bt_build_job right = {
+        .build = build, .lo = mid + 1, .hi = job->hi, .parent = node,
+        .depth = job->depth + 1, .spawn = job->spawn - 1,
+    };
+
+    // Left half on a new thread while we do the right, or both here.
+    pthread_t thread;
+    bool threaded = job->spawn > 0
+                    && pthread_create(&thread, NULL, bt_build_thread, &left) == 0;
+    if (!threaded)
+        bt_build_job_run(&left);
+    bt_build_job_run(&right);
+    if (threaded)
+        pthread_join(thread, NULL);
+
+    node->lchild = left.node;
+    node->rchild = right.node;
+    job->node    = node;
+    job->height  = 1 + ((left.height > right.height) ? left.height : right.height);
+
+    if (build->root->balance == BT_AVL)
+        node->height = job->height;
+    else
+        node->red = (job->depth == build->red_depth);
+}
+
+static bool bt_build(bt_root *root, void **objs, size_t n, int nthreads)
+{
+    if (root == NULL || root->branch != NULL) return false;
+    if (n == 0) return true;
+
+    bt_branch *block = malloc(sizeof(bt_branch) * n);
+    if (block == NULL) return false;
+
+    // An emptied tree may still have an old block, nothing points into it.
+    free(root->block);
+    root->block    = NULL;
+    root->blocklen = 0;
+
+    // Red-black: all black is fine if the last level is full. If not, make
+    // the last level red, so every path has the same # of black nodes.
+    int height = 0;
+    while (((size_t)1 << height) - 1 < n)
+        height++;
+
+    struct bt_build build = {
+        .root = root, .objs = objs, .count = n, .block = block,
+        .red_depth = (((size_t)1 << height) - 1 == n) ? -1 : height - 1,
+        .sorted = true,
+    };
+
+    // 2^spawn threads all up, the first of them being us.
+    int spawn = 0;
+    while ((1 << spawn) < nthreads)
+        spawn++;
+
+    struct bt_build_job job = {
+        .build = &build, .lo = 0, .hi = n, .parent = NULL, .depth = 0,
+        .spawn = spawn,
+    };
+    bt_build_job_run(&job);
+
+    if (!build.sorted)
+    {
+        free(block);
+        return false;
+    }
+    root->branch    = job.node;
+    root->block     = block;
+    root->blocklen  = n;
+    root->nodecount = n;
+    return true;
+}
+
+bool bt_build_sorted(bt_root *root, void **objs, size_t n)
+{
+    return bt_build(root, objs, n, 1);
+}
+
+bool bt_build_sorted_parallel(bt_root *root, void **objs, size_t n,
+                              int nthreads)
+{
+    return bt_build(root, objs, n, nthreads);
+}
+
 bool bt_remove(bt_root *root, void *obj)
 {
     bt_branch *target = bt_lookup(root, obj);
@@ -138,71 +310,287 @@ bool bt_remove(bt_root *root, void *obj)
     if (target == NULL || root->comparefn(target->obj, obj) != BOTH_SAME)
         return false;
 
-    // Reassign the children's parent pointers so we don't lose their handles.
-    if (!target->parent)
+    root->freefn(target->obj);
+
+    // With 2 children, take over the object of the next node in order (the
+    // leftmost of the right subtree) and remove that node instead. It has no
+    // left child, so the cases below cover it.
+    if (target->lchild && target->rchild)
     {
-        // Maybe one day I'll figure this out, but for now too lazy
-        printf("[ERROR] Cannot delete the top of the binary tree yet!\n");
-        return false;
+        bt_branch *next = target->rchild;
+        while (next->lchild)
+            next = next->lchild;
+        target->obj = next->obj;
+        target = next;
     }
 
-    int cmp = root->comparefn(target->parent->obj, target->obj);
+    // <target> has at most 1 child now, which just moves up into its place.
+    bt_branch *child  = (target->lchild) ? target->lchild : target->rchild;
+    bt_branch *parent = target->parent;
+    bt_replace(root, target, child);
 
-    reassign_children(cmp, target->parent, target);
-    
-    root->freefn(target->obj);
-    free(target);
+    if (root->balance == BT_AVL)
+        avl_retrace(root, parent);
+    else if (root->balance == BT_REDBLACK && !target->red)
+        rb_remove_fixup(root, child, parent);
+
+    bt_free_node(root, target);
+    root->nodecount--;
     return true;
 }
 
 /**
- * @note This may leak memory, have fun :)
- * @todo Properly reassign if target's children nodes also have children.
+ * @brief Put <child> (may be <NULL>) where <target> is, from its parent's view.
+ * @note <target>'s own pointers are left as they were.
  */
-static void reassign_children(int cmp, bt_branch *parent, bt_branch *target)
+static void bt_replace(bt_root *root, bt_branch *target, bt_branch *child)
 {
-    // shorthand meaning "target node's left child".
-    bt_branch *tlchild = target->lchild;
+    bt_branch *parent = target->parent;
 
-    // shorthand meaning "target node's right child".
-    bt_branch *trchild = target->rchild;
+    if (child)
+        child->parent = parent;
 
-    bool both_null = !tlchild && !trchild;
-    bool both_true =  tlchild &&  trchild;
+    if (!parent)
+        root->branch = child;
+    else if (parent->lchild == target)
+        parent->lchild = child;
+    else
+        parent->rchild = child;
+}
 
-    // Clear the cases where both children return the same boolean.
-    // That is, target node either as no children or it has 2 children.
-    if (both_null || both_true)
+/**
+ * @brief Move <node>'s right child up into its place, <node> becomes its
+ * left child. Order is kept, only the shape changes:
+ *
+ *      node               r
+ *      /  \              / \
+ *     a    r    -->   node  c
+ *         / \         /  \
+ *        b   c       a    b
+ */
+static void bt_rotate_left(bt_root *root, bt_branch *node)
+{
+    bt_branch *r = node->rchild;
+
+    node->rchild = r->lchild;
+    if (r->lchild)
+        r->lchild->parent = node;
+
+    bt_replace(root, node, r);
+    r->lchild = node;
+    node->parent = r;
+}
+
+// Mirror image of bt_rotate_left.
+static void bt_rotate_right(bt_root *root, bt_branch *node)
+{
+    bt_branch *l = node->lchild;
+
+    node->lchild = l->rchild;
+    if (l->rchild)
+        l->rchild->parent = node;
+
+    bt_replace(root, node, l);
+    l->rchild = node;
+    node->parent = l;
+}
+
+static int avl_height(bt_branch *node)
+{
+    return (node) ? node->height : 0;
+}
+
+static void avl_update(bt_branch *node)
+{
+    int lheight = avl_height(node->lchild);
+    int rheight = avl_height(node->rchild);
+    node->height = 1 + ((lheight > rheight) ? lheight : rheight);
+}
+
+/**
+ * @brief Walk up from <node> to the top, fixing heights and rotating any
+ * node whose 2 subtrees' heights differ by 2.
+ * @note Both insert and remove can only unbalance <node> and its parents.
+ */
+static void avl_retrace(bt_root *root, bt_branch *node)
+{
+    while (node)
     {
-        switch (cmp) 
+        int diff = avl_height(node->lchild) - avl_height(node->rchild);
+
+        if (diff > 1)
         {
-            // If we're removing a node with 2 children,
-            // target's right/left child will "adopt" the other one.
-            case IS_LCHILD: parent->lchild = (trchild) ? trchild : NULL;
-                            if (trchild) 
-                                trchild->lchild = tlchild;
-                            break;
+            // Left-right case: straighten it into left-left first.
+            bt_branch *l = node->lchild;
+            if (avl_height(l->lchild) < avl_height(l->rchild))
+            {
+                bt_rotate_left(root, l);
+                avl_update(l);
+                avl_update(l->parent);
+            }
+            bt_rotate_right(root, node);
+        }
+        else if (diff < -1)
+        {
+            bt_branch *r = node->rchild;
+            if (avl_height(r->rchild) < avl_height(r->lchild))
+            {
+                bt_rotate_right(root, r);
+                avl_update(r);
+                avl_update(r->parent);
+            }
+            bt_rotate_left(root, node);
+        }
 
-            case IS_RCHILD: parent->rchild = (tlchild) ? tlchild : NULL;
-                            if (tlchild)
-                                tlchild->rchild = trchild;
-                            break;
+        // After a rotation <node> is 1 level down, its new parent comes next.
+        avl_update(node);
+        if (diff > 1 || diff < -1)
+        {
+            node = node->parent;
+            avl_update(node);
         }
-        // Return so we don't need to make an explicit else case with indent.
-        return;
+        node = node->parent;
     }
+}
 
-    // Assumption here is that one child isn't NULL but the other is.
-    // Set parent->left/right child to whichever target->child isn't NULL.
-    switch (cmp)
+// <NULL> children count as black leaves.
+static bool rb_is_red(bt_branch *node)
+{
+    return node && node->red;
+}
+
+/**
+ * @brief Fix a red <node> whose parent may also be red.
+ * @note The 3 cases are the usual ones: recolor when the uncle is red,
+ * otherwise 1 or 2 rotations around the grandparent.
+ */
+static void rb_insert_fixup(bt_root *root, bt_branch *node)
+{
+    while (rb_is_red(node->parent))
     {
-        // If this doesn't make sense, try drawing it out on paper!
-        case IS_LCHILD: parent->lchild = (tlchild) ? tlchild : trchild;
-                        break;
+        bt_branch *parent = node->parent;
+        bt_branch *grand  = parent->parent;     // Red parents aren't the top.
 
-        case IS_RCHILD: parent->rchild = (trchild) ? trchild : tlchild;
-                        break;
+        if (parent == grand->lchild)
+        {
+            bt_branch *uncle = grand->rchild;
+            if (rb_is_red(uncle))
+            {
+                parent->red = false;
+                uncle->red  = false;
+                grand->red  = true;
+                node = grand;
+                continue;
+            }
+            if (node == parent->rchild)
+            {
+                bt_rotate_left(root, parent);
+                node   = parent;
+                parent = node->parent;
+            }
+            parent->red = false;
+            grand->red  = true;
+            bt_rotate_right(root, grand);
+        }
+        else
+        {
+            bt_branch *uncle = grand->lchild;
+            if (rb_is_red(uncle))
+            {
+                parent->red = false;
+                uncle->red  = false;
+                grand->red  = true;
+                node = grand;
+                continue;
+            }
+            if (node == parent->lchild)
+            {
+                bt_rotate_right(root, parent);
+                node   = parent;
+                parent = node->parent;
+            }
+            parent->red = false;
+            grand->red  = true;
+            bt_rotate_left(root, grand);
+        }
     }
+    root->branch->red = false;
+}
+
+/**
+ * @brief A black node was removed from under <parent>, and <node> (may be
+ * <NULL>) took its place, so that side is 1 black short.
+ * @note <parent> is passed in since <node> may not exist to ask.
+ */
+static void rb_remove_fixup(bt_root *root, bt_branch *node, bt_branch *parent)
+{
+    while (node != root->branch && !rb_is_red(node))
+    {
+        // The sibling can't be <NULL>: its side has at least 1 black more.
+        if (node == parent->lchild)
+        {
+            bt_branch *sibling = parent->rchild;
+            if (sibling->red)
+            {
+                sibling->red = false;
+                parent->red  = true;
+                bt_rotate_left(root, parent);
+                sibling = parent->rchild;
+            }
+            if (!rb_is_red(sibling->lchild) && !rb_is_red(sibling->rchild))
+            {
+                // Take a black off the sibling's side too, push it up.
+                sibling->red = true;
+                node   = parent;
+                parent = node->parent;
+                continue;
+            }
+            if (!rb_is_red(sibling->rchild))
+            {
+                sibling->lchild->red = false;
+                sibling->red = true;
+                bt_rotate_right(root, sibling);
+                sibling = parent->rchild;
+            }
+            sibling->red = parent->red;
+            parent->red  = false;
+            sibling->rchild->red = false;
+            bt_rotate_left(root, parent);
+        }
+        else
+        {
+            bt_branch *sibling = parent->lchild;
+            if (sibling->red)
+            {
+                sibling->red = false;
+                parent->red  = true;
+                bt_rotate_right(root, parent);
+                sibling = parent->lchild;
+            }
+            if (!rb_is_red(sibling->lchild) && !rb_is_red(sibling->rchild))
+            {
+                sibling->red = true;
+                node   = parent;
+                parent = node->parent;
+                continue;
+            }
+            if (!rb_is_red(sibling->lchild))
+            {
+                sibling->rchild->red = false;
+                sibling->red = true;
+                bt_rotate_left(root, sibling);
+                sibling = parent->lchild;
+            }
+            sibling->red = parent->red;
+            parent->red  = false;
+            sibling->lchild->red = false;
+            bt_rotate_right(root, parent);
+        }
+        // The extra black found a home, we're done.
+        node = root->branch;
+    }
+    if (node)
+        node->red = false;
 }
 
 void *bt_search(bt_root *root, void *obj)
@@ -210,11 +598,128 @@ void *bt_search(bt_root *root, void *obj)
     bt_branch *ptr = bt_lookup(root, obj);
 
     // Object does not exist in the list or the list itself is invalid
-    if (!ptr || root->comparefn(ptr, obj) != BOTH_SAME)
+    if (!ptr || root->comparefn(ptr->obj, obj) != BOTH_SAME)
         return NULL;
     return ptr->obj;
 }
 
+bt_branch *bt_first(bt_root *root)
+{
+    if (root == NULL || root->branch == NULL) return NULL;
+
+    bt_branch *node = root->branch;
+    while (node->lchild)
+        node = node->lchild;
+    return node;
+}
+
+bt_branch *bt_last(bt_root *root)
+{
+    if (root == NULL || root->branch == NULL) return NULL;
+
+    bt_branch *node = root->branch;
+    while (node->rchild)
+        node = node->rchild;
+    return node;
+}
+
+bt_branch *bt_next(bt_branch *node)
+{
+    if (node == NULL) return NULL;
+
+    // Anything to the right? Its leftmost node is next.
+    if (node->rchild)
+    {
+        node = node->rchild;
+        while (node->lchild)
+            node = node->lchild;
+        return node;
+    }
+
+    // Otherwise climb until we come up out of a left subtree.
+    // That parent is next, it was waiting on everything below its left.
+    while (node->parent && node == node->parent->rchild)
+        node = node->parent;
+    return node->parent;
+}
+
+// Mirror image of bt_next.
+bt_branch *bt_prev(bt_branch *node)
+{
+    if (node == NULL) return NULL;
+
+    if (node->lchild)
+    {
+        node = node->lchild;
+        while (node->rchild)
+            node = node->rchild;
+        return node;
+    }
+
+    while (node->parent && node == node->parent->lchild)
+        node = node->parent;
+    return node->parent;
+}
+
+bt_branch *bt_lower_bound(bt_root *root, void *obj)
+{
+    if (root == NULL) return NULL;
+
+    // Best match so far: every node >= <obj> we pass might be it,
+    // until we find a smaller one further left.
+    bt_branch *found = NULL;
+    bt_branch *node  = root->branch;
+    while (node)
+    {
+        if (root->comparefn(node->obj, obj) == IS_RCHILD)
+            node = node->rchild;
+        else
+        {
+            found = node;
+            node  = node->lchild;
+        }
+    }
+    return found;
+}
+
+bt_branch *bt_upper_bound(bt_root *root, void *obj)
+{
+    if (root == NULL) return NULL;
+
+    // Same as bt_lower_bound, but equal objects go right too.
+    bt_branch *found = NULL;
+    bt_branch *node  = root->branch;
+    while (node)
+    {
+        if (root->comparefn(node->obj, obj) != IS_LCHILD)
+            node = node->rchild;
+        else
+        {
+            found = node;
+            node  = node->lchild;
+        }
+    }
+    return found;
+}
+
+size_t bt_range(bt_root *root, void *lo, void *hi, bt_visit *fn, void *arg)
+{
+    if (root == NULL || fn == NULL) return 0;
+
+    size_t visited = 0;
+    bt_branch *node = (lo) ? bt_lower_bound(root, lo) : bt_first(root);
+    for (; node; node = bt_next(node))
+    {
+        if (hi && root->comparefn(node->obj, hi) == IS_LCHILD)
+            break;
+
+        visited++;
+        if (!fn(node->obj, arg))
+            break;
+    }
+    return visited;
+}
+
 void bt_printbt(bt_root *root)
 {
     int recurse = 0;
@@ -242,22 +747,33 @@ void bt_destroy(bt_root **root_address)
     bt_root *root = *root_address;
     if (!root) return;
 
-    bt_destroy_recurse(root->freefn, root->branch);
+    bt_destroy_recurse(root, root->branch);
+    free(root->block);
     free(root);
     *root_address = NULL;
 }
 
-static void bt_destroy_recurse(free_obj *freefn, bt_branch *node)
+static void bt_destroy_recurse(bt_root *root, bt_branch *node)
 {
     // Base case for recursion to avoid infinite loops.
     // I'm having a hard time finding a non-recursive way of going about this.
     if (!node) return;
 
     // Free the binary tree from bottom-up in a "walkdown-walkup" motion.
-    bt_destroy_recurse(freefn, node->lchild);
-    bt_destroy_recurse(freefn, node->rchild);
+    bt_destroy_recurse(root, node->lchild);
+    bt_destroy_recurse(root, node->rchild);
 
-    freefn(node->obj);
+    root->freefn(node->obj);
+    bt_free_node(root, node);
+}
+
+// Nodes in <root->block> only go back with the whole block, in bt_destroy.
+static void bt_free_node(bt_root *root, bt_branch *node)
+{
+    uintptr_t addr  = (uintptr_t)node;
+    uintptr_t start = (uintptr_t)root->block;
+    if (addr >= start && addr < start + root->blocklen * sizeof(bt_branch))
+        return;
     free(node);
 }
 
@@ -16,9 +16,20 @@ typedef struct bt_node
     struct bt_node *parent;
     struct bt_node *lchild;
     struct bt_node *rchild;
+    // Only 1 of these is used, depending on the tree's balancing policy.
+    union
+    {
+        int height;         // BT_AVL: # of levels from here down, a leaf is 1.
+        bool red;           // BT_REDBLACK: this node's color.
+    };
 }
 bt_branch;
 
+// Pass 1 of these to bt_init as <balance>.
+#define BT_PLAIN    0 // No rebalancing, sorted inserts make a linked list.
+#define BT_REDBLACK 1 // Red-black: depth at most 2 log2(n), cheap inserts.
+#define BT_AVL      2 // AVL: depth at most ~1.44 log2(n), faster lookups.
+
 // Use these macros for your <cmp_obj> function.
 #define IS_LCHILD  1 // Return value for comparefn, if parent >  child
 #define IS_RCHILD -1 // Return value for comparefn, if parent <  child
@@ -58,6 +69,13 @@ typedef void free_obj(void *obj);
  */
 typedef void printobj(void *obj);
 
+/**
+ * @brief Visit 1 object of a bt_range query.
+ * @param arg Whatever you passed to bt_range.
+ * @return false to stop the query early.
+ */
+typedef bool bt_visit(void *obj, void *arg);
+
 
 typedef struct bt_struct
 {
@@ -66,6 +84,9 @@ typedef struct bt_struct
     free_obj  *freefn;
     printobj  *printfn;
     size_t     nodecount;
+    int        balance;     // BT_PLAIN, BT_REDBLACK or BT_AVL.
+    bt_branch *block;       // Nodes from bt_build_sorted, all 1 malloc.
+    size_t     blocklen;    // # of nodes in <block>.
 }
 bt_root;
 
@@ -77,18 +98,81 @@ bt_root;
  * @param cmpfn Pass <NULL> to compare 2 objects as if they are of type (int).
  * @param printfn Pass <NULL> to only print out the object's address.
  * @param freefn Pass <NULL> for <free> from <stdlib.h> [ C ], or <cstdlib> [ C++ ]
+ * @param balance BT_PLAIN, BT_REDBLACK or BT_AVL, see their definitions.
  * 
- * @return (bt_root*) a dynamically allocated handle to your binary tree.
+ * @return (bt_root*) a dynamically allocated handle to your binary tree,
+ *         or <NULL> if malloc failed or <balance> isn't 1 of the above.
  * 
  * @note <printfn>, <freefn> and <cmpfn> take params of type (void*)
  * @note The intention is for you to dereference them with your chosen type.
  * @note See "genbinarytree.h" for more information.
  */
-bt_root *bt_init(cmp_obj *cmpfn, printobj *printfn, free_obj *freefn);
+bt_root *bt_init(cmp_obj *cmpfn, printobj *printfn, free_obj *freefn,
+                 int balance);
 
 bool bt_insert(bt_root *root, void *obj);
+
+/**
+ * @brief Build a perfectly balanced tree out of <objs> in O(n), no lookups
+ *        and 1 malloc for all <n> nodes, instead of <n> bt_insert calls.
+ * @param objs Sorted smallest first by <comparefn>, no 2 the same.
+ * @return false if the tree isn't empty, malloc failed or <objs> wasn't
+ *         sorted. The tree is left empty then and no object is freed.
+ * @note Works for every balancing policy, later inserts and removes keep
+ *       it balanced. Removed nodes' memory comes back at bt_destroy.
+ */
+bool bt_build_sorted(bt_root *root, void **objs, size_t n);
+
+/**
+ * @brief Same as bt_build_sorted, but the left and right subtrees of the top
+ *        few levels are built on separate threads, <nthreads> in all.
+ */
+bool bt_build_sorted_parallel(bt_root *root, void **objs, size_t n,
+                              int nthreads);
+
+/**
+ * @brief Remove the node matching <obj>, the top of the tree included.
+ * @return false if there's no such node.
+ * @note The object in the tree is freed with <freefn>, <obj> itself isn't.
+ */
 bool bt_remove(bt_root *root, void *obj);
 void *bt_search(bt_root *root, void *obj);
+
+/**
+ * In-order cursors: a (bt_branch*) is a position in the tree, <NULL> is off
+ * either end. Moving 1 step follows the <parent> pointers, no stack needed,
+ * and a full walk is O(n) all up.
+ * @note bt_insert keeps every cursor valid. bt_remove invalidates the
+ * removed object's node, and with 2 children its successor's node too.
+ */
+
+// Node with the smallest object, <NULL> if the tree is empty.
+bt_branch *bt_first(bt_root *root);
+
+// Node with the largest object, <NULL> if the tree is empty.
+bt_branch *bt_last(bt_root *root);
+
+// Node right after <node> in order, <NULL> if it was the last.
+bt_branch *bt_next(bt_branch *node);
+
+// Node right before <node> in order, <NULL> if it was the first.
+bt_branch *bt_prev(bt_branch *node);
+
+// First node whose object is >= <obj>, <NULL> if there's none.
+bt_branch *bt_lower_bound(bt_root *root, void *obj);
+
+// First node whose object is > <obj>, <NULL> if there's none.
+bt_branch *bt_upper_bound(bt_root *root, void *obj);
+
+/**
+ * @brief Call <fn> on every object from <lo> to <hi> (both included), in
+ *        order. O(log n + k) for k objects.
+ * @param lo Pass <NULL> to start from the smallest object.
+ * @param hi Pass <NULL> to go all the way to the largest.
+ * @return # of objects <fn> was called on.
+ */
+size_t bt_range(bt_root *root, void *lo, void *hi, bt_visit *fn, void *arg);
+
 void bt_printbt(bt_root *root);
 void bt_destroy(bt_root **root_address);
 
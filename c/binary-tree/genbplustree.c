@@ -0,0 +1,471 @@
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "genbplustree.h"
+
+// Nodes start on a cache line of their own.
+#define BPT_ALIGN 64
+
+// "Private" functions not meant for you, the user, to invoke in your program.
+static bpt_node *bpt_new_node(bool leaf);
+static int bpt_bound(bpt_root *root, bpt_node *node, void *obj, bool upper);
+static bool bpt_split_child(bpt_node *parent, int i);
+static int bpt_fix_child(bpt_node *parent, int i);
+static void bpt_merge(bpt_node *parent, int i);
+static void bpt_insert_at(bpt_node *parent, int i, void *key, bpt_node *right);
+static void bpt_remove_at(bpt_node *parent, int i);
+static void bpt_print_recurse(int recurse, printobj *printfn, bpt_node *node);
+static void bpt_destroy_recurse(free_obj *freefn, bpt_node *node);
+static int bpt_cmpfn(void *parent, void *child);
+static void bpt_printfn(void *obj);
+
+bpt_root *bpt_init(cmp_obj *cmpfn, printobj *printfn, free_obj *freefn)
+{
+    bpt_root *new_bpt = malloc(sizeof(bpt_root));
+    if (new_bpt == NULL) return NULL;
+
+    new_bpt->top       = NULL;
+    new_bpt->comparefn = (cmpfn)   ? cmpfn   : bpt_cmpfn;
+    new_bpt->printfn   = (printfn) ? printfn : bpt_printfn;
+    new_bpt->freefn    = (freefn)  ? freefn  : free;
+    new_bpt->nodecount = 0;
+    new_bpt->height    = 0;
+
+    return new_bpt;
+}
+
+bool bpt_insert(bpt_root *root, void *obj)
+{
+    if (root == NULL) return false;
+
+    if (root->top == NULL)
+    {
+        bpt_node *leaf = bpt_new_node(true);
+        if (leaf == NULL) return false;
+
+        leaf->keys[0] = obj;
+        leaf->count   = 1;
+        root->top     = leaf;
+        root->height  = 1;
+        root->nodecount++;
+        return true;
+    }
+
+    // Split full nodes on the way down, so there's always room for whatever
+    // a split below pushes up. A full top gets a new, empty top above it.
+    if (root->top->count == BPT_MAX_KEYS)
+    {
+        bpt_node *top = bpt_new_node(false);
+        if (top == NULL) return false;
+
+        top->children[0] = root->top;
+        if (!bpt_split_child(top, 0))
+        {
+            free(top);
+            return false;
+        }
+        root->top = top;
+        root->height++;
+    }
+
+    bpt_node *node = root->top;
+    while (!node->leaf)
+    {
+        int i = bpt_bound(root, node, obj, true);
+        if (node->children[i]->count == BPT_MAX_KEYS)
+        {
+            if (!bpt_split_child(node, i)) return false;
+
+            // The new key at <i> is the smallest of the right half.
+            if (root->comparefn(node->keys[i], obj) != IS_LCHILD)
+                i++;
+        }
+        node = node->children[i];
+    }
+
+    int pos = bpt_bound(root, node, obj, false);
+    if (pos < node->count && root->comparefn(node->keys[pos], obj) == BOTH_SAME)
+        return false;
+
+    memmove(&node->keys[pos + 1], &node->keys[pos],
+            (node->count - pos) * sizeof(void*));
+    node->keys[pos] = obj;
+    node->count++;
+    root->nodecount++;
+    return true;
+}
+
+bool bpt_remove(bpt_root *root, void *obj)
+{
+    if (root == NULL || root->top == NULL) return false;
+
+    // Same idea as inserting: top it up before going into a child that's at
+    // the minimum, so the leaf can lose 1 and no node ends up too small.
+    bpt_node *node = root->top;
+    while (!node->leaf)
+    {
+        int i = bpt_bound(root, node, obj, true);
+        if (node->children[i]->count <= BPT_MIN_KEYS)
+            i = bpt_fix_child(node, i);
+
+        bpt_node *child = node->children[i];
+        if (node->count == 0)
+        {
+            // Only the top can run out, when its last 2 children merged.
+            root->top = child;
+            root->height--;
+            free(node);
+        }
+        node = child;
+    }
+
+    int pos = bpt_bound(root, node, obj, false);
+    if (pos >= node->count || root->comparefn(node->keys[pos], obj) != BOTH_SAME)
+        return false;
+
+    void *victim = node->keys[pos];
+    memmove(&node->keys[pos], &node->keys[pos + 1],
+            (node->count - pos - 1) * sizeof(void*));
+    node->count--;
+    root->nodecount--;
+
+    if (node->count == 0)
+    {
+        // Only a lone top leaf can be emptied.
+        free(node);
+        root->top    = NULL;
+        root->height = 0;
+    }
+    else if (pos == 0)
+    {
+        // The smallest of a leaf may also be a key up in an inner node. It's
+        // about to be freed, so swap in the leaf's new smallest there.
+        bpt_node *inner = root->top;
+        while (!inner->leaf)
+        {
+            int i = bpt_bound(root, inner, victim, true);
+            if (i > 0 && inner->keys[i - 1] == victim)
+            {
+                inner->keys[i - 1] = node->keys[0];
+                break;
+            }
+            inner = inner->children[i];
+        }
+    }
+
+    root->freefn(victim);
+    return true;
+}
+
+void *bpt_search(bpt_root *root, void *obj)
+{
+    if (root == NULL || root->top == NULL) return NULL;
+
+    bpt_node *node = root->top;
+    while (!node->leaf)
+        node = node->children[bpt_bound(root, node, obj, true)];
+
+    int pos = bpt_bound(root, node, obj, false);
+    if (pos < node->count && root->comparefn(node->keys[pos], obj) == BOTH_SAME)
+        return node->keys[pos];
+    return NULL;
+}
+
+size_t bpt_range(bpt_root *root, void *lo, void *hi, bpt_visit *fn, void *arg)
+{
+    if (root == NULL || root->top == NULL || fn == NULL) return 0;
+
+    bpt_node *node = root->top;
+    while (!node->leaf)
+        node = node->children[(lo) ? bpt_bound(root, node, lo, true) : 0];
+
+    // From here on it's just the leaves, left to right.
+    size_t visited = 0;
+    int pos = (lo) ? bpt_bound(root, node, lo, false) : 0;
+    for (; node; node = node->next, pos = 0)
+    {
+        for (; pos < node->count; pos++)
+        {
+            if (hi && root->comparefn(node->keys[pos], hi) == IS_LCHILD)
+                return visited;
+
+            visited++;
+            if (!fn(node->keys[pos], arg))
+                return visited;
+        }
+    }
+    return visited;
+}
+
+void bpt_printbpt(bpt_root *root)
+{
+    if (root == NULL) return;
+
+    int recurse = 0;
+    bpt_print_recurse(recurse, root->printfn, root->top);
+}
+
+void bpt_destroy(bpt_root **root_address)
+{
+    bpt_root *root = *root_address;
+    if (!root) return;
+
+    bpt_destroy_recurse(root->freefn, root->top);
+    free(root);
+    *root_address = NULL;
+}
+
+// Malloc a node, inner or leaf, on its own cache line(s).
+static bpt_node *bpt_new_node(bool leaf)
+{
+    size_t size = sizeof(bpt_node);
+    if (!leaf)
+        size += (BPT_MAX_KEYS + 1) * sizeof(bpt_node*);
+
+    // aligned_alloc wants a multiple of the alignment.
+    size = (size + BPT_ALIGN - 1) / BPT_ALIGN * BPT_ALIGN;
+    bpt_node *node = aligned_alloc(BPT_ALIGN, size);
+    if (node == NULL) return NULL;
+
+    node->count = 0;
+    node->leaf  = leaf;
+    node->next  = NULL;
+    return node;
+}
+
+/**
+ * @brief Binary search <node>'s keys for <obj>.
+ * @param upper false for the first key >= <obj>, true for the first key > it.
+ * @return Its index, or <node->count> if there's none.
+ * @note With <upper>, that's also the child to go down into for <obj>.
+ */
+static int bpt_bound(bpt_root *root, bpt_node *node, void *obj, bool upper)
+{
+    int lo = 0;
+    int hi = node->count;
+
+    while (lo < hi)
+    {
+        int mid = (lo + hi) / 2;
+        int cmp = root->comparefn(node->keys[mid], obj);
+
+        if (cmp == IS_RCHILD || (upper && cmp == BOTH_SAME))
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+/**
+ * @brief Split <parent>'s full child <i> in 2, the new one going at <i> + 1.
+ * @return false if malloc failed, then nothing changed.
+ */
+static bool bpt_split_child(bpt_node *parent, int i)
+{
+    bpt_node *child = parent->children[i];
+    bpt_node *right = bpt_new_node(child->leaf);
+    if (right == NULL) return false;
+
+    int half = BPT_MAX_KEYS / 2;
+    void *key;
+
+    if (child->leaf)
+    {
+        // Leaves keep every object: the right half's smallest is only copied.
+        right->count = BPT_MAX_KEYS - half;
+        memcpy(right->keys, &child->keys[half], right->count * sizeof(void*));
+        child->count = half;
+
+        right->next = child->next;
+        child->next = right;
+        key = right->keys[0];
+    }
+    else
+    {
+        // Inner nodes give the middle key up to <parent> for good.
+        right->count = BPT_MAX_KEYS - half - 1;
+        memcpy(right->keys, &child->keys[half + 1],
+               right->count * sizeof(void*));
+        memcpy(right->children, &child->children[half + 1],
+               (right->count + 1) * sizeof(bpt_node*));
+        child->count = half;
+        key = child->keys[half];
+    }
+
+    bpt_insert_at(parent, i, key, right);
+    return true;
+}
+
+/**
+ * @brief <parent>'s child <i> is at BPT_MIN_KEYS, get it 1 more: borrow
+ * from a sibling that can spare 1, or else merge it with 1.
+ * @return Index of the child that now holds what child <i> held.
+ */
+static int bpt_fix_child(bpt_node *parent, int i)
+{
+    bpt_node *child = parent->children[i];
+    bpt_node *left  = (i > 0) ? parent->children[i - 1] : NULL;
+    bpt_node *right = (i < parent->count) ? parent->children[i + 1] : NULL;
+
+    if (left && left->count > BPT_MIN_KEYS)
+    {
+        memmove(&child->keys[1], &child->keys[0], child->count * sizeof(void*));
+        if (child->leaf)
+        {
+            child->keys[0] = left->keys[left->count - 1];
+            parent->keys[i - 1] = child->keys[0];
+        }
+        else
+        {
+            // Rotate right through <parent>: its key comes down, left's goes up.
+            memmove(&child->children[1], &child->children[0],
+                    (child->count + 1) * sizeof(bpt_node*));
+            child->keys[0] = parent->keys[i - 1];
+            child->children[0] = left->children[left->count];
+            parent->keys[i - 1] = left->keys[left->count - 1];
+        }
+        child->count++;
+        left->count--;
+        return i;
+    }
+
+    if (right && right->count > BPT_MIN_KEYS)
+    {
+        if (child->leaf)
+        {
+            child->keys[child->count] = right->keys[0];
+            parent->keys[i] = right->keys[1];
+        }
+        else
+        {
+            child->keys[child->count] = parent->keys[i];
+            child->children[child->count + 1] = right->children[0];
+            parent->keys[i] = right->keys[0];
+            memmove(&right->children[0], &right->children[1],
+                    right->count * sizeof(bpt_node*));
+        }
+        memmove(&right->keys[0], &right->keys[1],
+                (right->count - 1) * sizeof(void*));
+        child->count++;
+        right->count--;
+        return i;
+    }
+
+    if (left)
+    {
+        bpt_merge(parent, i - 1);
+        return i - 1;
+    }
+    bpt_merge(parent, i);
+    return i;
+}
+
+// Fold <parent>'s child <i> + 1 into child <i>, both at the minimum.
+static void bpt_merge(bpt_node *parent, int i)
+{
+    bpt_node *left  = parent->children[i];
+    bpt_node *right = parent->children[i + 1];
+
+    if (left->leaf)
+    {
+        memcpy(&left->keys[left->count], right->keys,
+               right->count * sizeof(void*));
+        left->count += right->count;
+        left->next = right->next;
+    }
+    else
+    {
+        // <parent>'s key between them comes down in the middle.
+        left->keys[left->count] = parent->keys[i];
+        memcpy(&left->keys[left->count + 1], right->keys,
+               right->count * sizeof(void*));
+        memcpy(&left->children[left->count + 1], right->children,
+               (right->count + 1) * sizeof(bpt_node*));
+        left->count += right->count + 1;
+    }
+
+    bpt_remove_at(parent, i);
+    free(right);
+}
+
+// Put <key> at <parent>->keys[i] and <right> just right of it.
+static void bpt_insert_at(bpt_node *parent, int i, void *key, bpt_node *right)
+{
+    memmove(&parent->keys[i + 1], &parent->keys[i],
+            (parent->count - i) * sizeof(void*));
+    memmove(&parent->children[i + 2], &parent->children[i + 1],
+            (parent->count - i) * sizeof(bpt_node*));
+    parent->keys[i] = key;
+    parent->children[i + 1] = right;
+    parent->count++;
+}
+
+// Undo bpt_insert_at: drop <parent>->keys[i] and the child right of it.
+static void bpt_remove_at(bpt_node *parent, int i)
+{
+    memmove(&parent->keys[i], &parent->keys[i + 1],
+            (parent->count - i - 1) * sizeof(void*));
+    memmove(&parent->children[i + 1], &parent->children[i + 2],
+            (parent->count - i - 1) * sizeof(bpt_node*));
+    parent->count--;
+}
+
+/**
+ * @brief Print the tree sideways like bt_printbt, 1 tab per level.
+ * @note An inner node's keys go between the children they separate.
+ */
+static void bpt_print_recurse(int recurse, printobj *printfn, bpt_node *node)
+{
+    if (!node) return;
+
+    for (int k = 0; k <= node->count; k++)
+    {
+        if (!node->leaf)
+            bpt_print_recurse(recurse + 1, printfn, node->children[k]);
+        if (k == node->count)
+            break;
+
+        for (int i = 0; i < recurse; i++)
+            printf("\t");
+        printfn(node->keys[k]);
+    }
+}
+
+static void bpt_destroy_recurse(free_obj *freefn, bpt_node *node)
+{
+    if (!node) return;
+
+    // Inner keys are only copies, the leaves hold the real objects.
+    if (node->leaf)
+    {
+        for (int k = 0; k < node->count; k++)
+            freefn(node->keys[k]);
+    }
+    else
+    {
+        for (int k = 0; k <= node->count; k++)
+            bpt_destroy_recurse(freefn, node->children[k]);
+    }
+    free(node);
+}
+
+// Same defaults as genbinarytree.c, which keeps its own static.
+static int bpt_cmpfn(void *parent, void *child)
+{
+    int x = *(int*)parent;
+    int y = *(int*)child;
+
+    if (x > y)
+        return IS_LCHILD;
+    else if (x < y)
+        return IS_RCHILD;
+    return BOTH_SAME;
+}
+
+static void bpt_printfn(void *obj)
+{
+    printf("%p\n", obj);
+}
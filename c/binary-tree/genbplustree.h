@@ -0,0 +1,96 @@
+#ifndef GENERAL_PURPOSE_BPLUS_TREE_H
+#define GENERAL_PURPOSE_BPLUS_TREE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif // __cplusplus (start)
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+// Same <cmp_obj>, <free_obj> and <printobj> callbacks as bt_root.
+#include "genbinarytree.h"
+
+/**
+ * A B+ tree: an ordered set of (void*) objects like bt_root, but every node
+ * holds up to BPT_MAX_KEYS of them in 1 array instead of 1 per malloc.
+ * A search touches about log(n) / log(BPT_MAX_KEYS) nodes rather than
+ * log2(n), and binary searches each node's array in place.
+ *
+ * Objects all live in the leaves, which are linked left to right, so a range
+ * scan walks arrays instead of climbing up and down the tree. Inner nodes
+ * only hold copies of some of those object pointers, to steer searches.
+ */
+
+// Leaves come to 256 bytes (4 cache lines), inner nodes to 512 (8).
+#define BPT_MAX_KEYS 30
+
+// Every node but the top keeps at least this many, so merges always fit.
+#define BPT_MIN_KEYS ((BPT_MAX_KEYS - 1) / 2)
+
+typedef struct bpt_node
+{
+    int count;                  // # of <keys> in use.
+    bool leaf;
+    struct bpt_node *next;      // Leaves only: the leaf to the right.
+    void *keys[BPT_MAX_KEYS];   // Sorted, smallest first.
+    // Inner nodes only, BPT_MAX_KEYS + 1 of them. children[i] < keys[i].
+    struct bpt_node *children[];
+}
+bpt_node;
+
+typedef struct bpt_struct
+{
+    bpt_node *top;              // A leaf while it all fits in 1 node.
+    cmp_obj  *comparefn;
+    free_obj *freefn;
+    printobj *printfn;
+    size_t    nodecount;        // # of objects, not nodes (same as bt_root).
+    size_t    height;           // # of levels, a lone leaf is 1.
+}
+bpt_root;
+
+/**
+ * @brief Visit 1 object of a range scan.
+ * @param arg Whatever you passed to bpt_range.
+ * @return false to stop the scan early.
+ */
+typedef bool bpt_visit(void *obj, void *arg);
+
+/**
+ * @brief Initialize an empty B+ tree, same callbacks and defaults as bt_init.
+ * @return (bpt_root*) a dynamically allocated handle, <NULL> if malloc failed.
+ */
+bpt_root *bpt_init(cmp_obj *cmpfn, printobj *printfn, free_obj *freefn);
+
+/**
+ * @brief Add <obj> to the tree.
+ * @return false if an equal object is in already, or a malloc failed.
+ */
+bool bpt_insert(bpt_root *root, void *obj);
+
+/**
+ * @brief Remove the object equal to <obj>, and free it with <freefn>.
+ * @return false if there's no such object.
+ */
+bool bpt_remove(bpt_root *root, void *obj);
+
+// (void*) to the object equal to <obj>, or <NULL>.
+void *bpt_search(bpt_root *root, void *obj);
+
+/**
+ * @brief Call <fn> on every object from <lo> to <hi> (both included), in order.
+ * @param lo Pass <NULL> to start from the smallest object.
+ * @param hi Pass <NULL> to go all the way to the largest.
+ * @return # of objects <fn> was called on.
+ */
+size_t bpt_range(bpt_root *root, void *lo, void *hi, bpt_visit *fn, void *arg);
+
+void bpt_printbpt(bpt_root *root);
+void bpt_destroy(bpt_root **root_address);
+
+#ifdef __cplusplus
+}
+#endif // __cplusplus (end)
+
+#endif // GENERAL_PURPOSE_BPLUS_TREE_H
@@ -0,0 +1,145 @@
+/**
+ * @file int_bench.c
+ * @brief Read-only int lookups: search_tree on a pointer tree, bsearch on a
+ * sorted array, and search_eytzinger on the same values frozen.
+ * Usage: ./int_bench [#values ...], 1M and 10M if none given.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "int_binary_tree.h"
+#include "int_eytzinger.h"
+
+#define SEARCHES 4000000
+
+static double now_seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int compare_ints(const void *a, const void *b)
+{
+    int x = *(const int *)a;
+    int y = *(const int *)b;
+    return (x > y) - (x < y);
+}
+
+// 64 bit xorshift, rand() doesn't go high enough for 10M on every libc.
+static uint64_t next_random(uint64_t *state)
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+static void report(const char *name, double elapsed, size_t found)
+{
+    // Print <found> so the compiler can't throw the searches away.
+    printf("    %-20s %7.1f ns/search  (found %zu)\n", name,
+           elapsed * 1e9 / SEARCHES, found);
+}
+
+static void bench(size_t count)
+{
+    // Even values only, so about half the searches miss.
+    int *sorted = malloc(sizeof(int) * count);
+    int *order = malloc(sizeof(int) * count);
+    int *lookups = malloc(sizeof(int) * SEARCHES);
+    treenode *tree = NULL;
+    eytzinger *set = NULL;
+    if (sorted == NULL || order == NULL || lookups == NULL)
+    {
+        goto end_bench;
+    }
+
+    uint64_t state = 42;
+    for (size_t i = 0; i < count; i++)
+    {
+        sorted[i] = order[i] = (int)(2 * i);
+    }
+    for (size_t i = count - 1; i > 0; i--)
+    {
+        size_t j = next_random(&state) % (i + 1);
+        int tmp = order[i];
+        order[i] = order[j];
+        order[j] = tmp;
+    }
+    for (size_t i = 0; i < SEARCHES; i++)
+    {
+        lookups[i] = (int)(next_random(&state) % (2 * count));
+    }
+
+    // Random insertion order, so the pointer tree is ~2 log2(n) deep.
+    for (size_t i = 0; i < count; i++)
+    {
+        insert_node(&tree, order[i]);
+    }
+    double start = now_seconds();
+    set = create_eytzinger_tree(tree);
+    double build = now_seconds() - start;
+    if (set == NULL)
+    {
+        goto end_bench;
+    }
+
+    printf("<< %zu values, %d searches, frozen in %.1f ms >>\n", count,
+           SEARCHES, build * 1e3);
+
+    size_t found = 0;
+    start = now_seconds();
+    for (size_t i = 0; i < SEARCHES; i++)
+    {
+        found += search_tree(tree, lookups[i]);
+    }
+    report("search_tree:", now_seconds() - start, found);
+
+    found = 0;
+    start = now_seconds();
+    for (size_t i = 0; i < SEARCHES; i++)
+    {
+        found += bsearch(&lookups[i], sorted, count, sizeof(int),
+                         compare_ints) != NULL;
+    }
+    report("bsearch:", now_seconds() - start, found);
+
+    found = 0;
+    start = now_seconds();
+    for (size_t i = 0; i < SEARCHES; i++)
+    {
+        found += search_eytzinger(set, lookups[i]);
+    }
+    report("search_eytzinger:", now_seconds() - start, found);
+
+    end_bench:
+    free_eytzinger(set);
+    free_tree_recurse(tree);
+    free(sorted);
+    free(order);
+    free(lookups);
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        bench(1000000);
+        bench(10000000);
+        return EXIT_SUCCESS;
+    }
+    for (int i = 1; i < argc; i++)
+    {
+        size_t count = strtoul(argv[i], NULL, 10);
+        if (count > 0)
+        {
+            bench(count);
+        }
+    }
+    return EXIT_SUCCESS;
+}
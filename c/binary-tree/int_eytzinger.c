@@ -0,0 +1,144 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "int_eytzinger.h"
+
+#define CACHE_LINE 64
+
+// # of ints per cache line, which is also 2^(# of levels we prefetch ahead).
+#define KEYS_PER_LINE (CACHE_LINE / sizeof(int))
+
+/**
+ * @brief Fill keys[k] and its subtree from <sorted>, in order.
+ * @return Index into <sorted> of the next value to place.
+ * @note An in-order walk of the implicit tree meets its slots smallest first,
+ * so handing out sorted values in that walk gives a valid search tree.
+ */
+static size_t fill_eytzinger(const int *sorted, int *keys, size_t i, size_t k,
+                             size_t count)
+{
+    if (k > count)
+    {
+        return i;
+    }
+    i = fill_eytzinger(sorted, keys, i, 2 * k, count);
+    keys[k] = sorted[i++];
+    return fill_eytzinger(sorted, keys, i, 2 * k + 1, count);
+}
+
+eytzinger *create_eytzinger_sorted(const int *sorted, size_t count)
+{
+    eytzinger *set = malloc(sizeof(eytzinger));
+    if (set == NULL)
+    {
+        return NULL;
+    }
+
+    /**
+     * Start on a cache line so every group of 16 descendants is exactly 1.
+     * aligned_alloc also wants the size to be a multiple of the alignment.
+     */
+    size_t bytes = (count + 1) * sizeof(int);
+    bytes = (bytes + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
+    set->keys = aligned_alloc(CACHE_LINE, bytes);
+    if (set->keys == NULL)
+    {
+        free(set);
+        return NULL;
+    }
+    set->count = count;
+    fill_eytzinger(sorted, set->keys, 0, 1, count);
+    return set;
+}
+
+static size_t count_tree(treenode *head)
+{
+    if (head == NULL)
+    {
+        return 0;
+    }
+    return 1 + count_tree(head->left) + count_tree(head->right);
+}
+
+// In-order walk, so <out> comes out sorted.
+static size_t copy_tree(treenode *head, int *out, size_t i)
+{
+    if (head == NULL)
+    {
+        return i;
+    }
+    i = copy_tree(head->left, out, i);
+    out[i++] = head->val;
+    return copy_tree(head->right, out, i);
+}
+
+eytzinger *create_eytzinger_tree(treenode *root)
+{
+    size_t count = count_tree(root);
+    int *sorted = malloc(sizeof(int) * (count + 1));
+    if (sorted == NULL)
+    {
+        return NULL;
+    }
+    copy_tree(root, sorted, 0);
+
+    eytzinger *set = create_eytzinger_sorted(sorted, count);
+    free(sorted);
+    return set;
+}
+
+/**
+ * @brief Go down 1 level per step without a branch: right if keys[k] < val.
+ * @return The slot of the smallest value >= <val>, 0 if there's none.
+ */
+static size_t descend_eytzinger(eytzinger *set, int val)
+{
+    const int *keys = set->keys;
+    size_t k = 1;
+
+    while (k <= set->count)
+    {
+        // Never read, so being past the end is fine: prefetches don't fault.
+        __builtin_prefetch((const void *)((uintptr_t)keys
+                                          + k * KEYS_PER_LINE * sizeof(int)));
+        k = 2 * k + (keys[k] < val);
+    }
+
+    /**
+     * <k> is now past the bottom. Each 1 bit at the end of it is a step we
+     * took right, past a value < <val>. The last step left (the lowest 0 bit)
+     * was at our answer, so drop the trailing 1s and that 0.
+     */
+    return k >> __builtin_ffsll(~(long long)k);
+}
+
+bool search_eytzinger(eytzinger *set, int val)
+{
+    if (set == NULL)
+    {
+        return false;
+    }
+    size_t k = descend_eytzinger(set, val);
+    return k != 0 && set->keys[k] == val;
+}
+
+const int *lower_bound_eytzinger(eytzinger *set, int val)
+{
+    if (set == NULL)
+    {
+        return NULL;
+    }
+    size_t k = descend_eytzinger(set, val);
+    return (k != 0) ? &set->keys[k] : NULL;
+}
+
+void free_eytzinger(eytzinger *set)
+{
+    if (set == NULL)
+    {
+        return;
+    }
+    free(set->keys);
+    free(set);
+}
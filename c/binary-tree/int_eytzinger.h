@@ -0,0 +1,48 @@
+#ifndef INT_EYTZINGER_H
+#define INT_EYTZINGER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "int_binary_tree.h"
+
+/**
+ * A frozen, read-only set of ints for lookups. The values are laid out in
+ * 1 array in the order a breadth-first walk of a balanced tree would visit
+ * them (Eytzinger order): the top is keys[1], and the children of keys[k]
+ * are keys[2k] and keys[2k + 1]. No pointers, so going down a level is just
+ * arithmetic, and the first few levels share a handful of cache lines.
+ *
+ * The 16 descendants 4 levels below keys[k] sit next to each other in 1
+ * cache line, so the search prefetches that line 4 levels ahead.
+ */
+typedef struct eytzinger
+{
+    int *keys;          // keys[1] to keys[count], keys[0] is unused.
+    size_t count;
+}
+eytzinger;
+
+/**
+ * @brief Freeze a sorted int array, smallest first.
+ * @return A new set, or <NULL> if malloc failed.
+ */
+eytzinger *create_eytzinger_sorted(const int *sorted, size_t count);
+
+/**
+ * @brief Freeze every value in an int tree. The tree itself is untouched.
+ * @return A new set, or <NULL> if malloc failed.
+ */
+eytzinger *create_eytzinger_tree(treenode *root);
+
+bool search_eytzinger(eytzinger *set, int val);
+
+/**
+ * @brief Find the smallest value >= <val>.
+ * @return (int*) into the set, or <NULL> if every value is smaller.
+ */
+const int *lower_bound_eytzinger(eytzinger *set, int val);
+
+void free_eytzinger(eytzinger *set);
+
+#endif // INT_EYTZINGER_H
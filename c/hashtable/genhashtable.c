@@ -12,94 +12,357 @@
 #include <stdlib.h>
 #include <string.h>
 
-#include "genhashtable.h"
-
-// Shorthand for "singly-linked list". Note the 2 lowercase 'L'.
-struct sllist
-{
-    char *key;            // NUL terminated string to use as hash input.
-    void *obj;            // obj ptr of any type, best to dynamically alloc.
-    struct sllist *next;
-};
-// Shorthand for "singly-linked list node". Note the 2 lowercase 'L'.
-typedef struct sllist sllnode;
-
-// <hashtable> will update when <generic_hashtable> updates.
-struct generic_hashtable 
-{
-    int size;                       // Total # of linked lists in the table.
-    uint64_t collisions;            // Total # of collisions in the table.
-    hash_function *hash_fn;         // Generates hash value from string key.
-    cleanup_function *clean_fn;     // Custom object cleanup fn, or <free>.
-    sllnode **elements;             // 1D array of linked lists for collisions.
-};
-
-/** 
- * @brief "private" function to properly call the hash_fn. 
- * @return size_t of the resulting hashed value.
- * @note  Check if <ht> and <key> are both not <NULL> before calling this.
-*/
-static size_t ht_hash(table *ht, const char *key)
+#include "genhashtable_internal.h"
+
+// # of buckets migrated to the bigger array by each insert/find/delete.
+#define REHASH_STEP 4
+
+uint64_t ht_hash(table *ht, const char *key, size_t length)
 {
     // Can return this directly, for debug see the <rax> register
     // or whatever register your device uses for return values.
-    return (ht->hash_fn(key, strlen(key)) % ht->size);
+    return ht->hash_fn(key, length);
+}
+
+char *ht_key_copy(table *ht, const char *key, size_t length)
+{
+    char *copy = (ht->flags & HT_POOLED) 
+        ? pool_key_alloc(&ht->pool, length + 1)
+        : malloc((length + 1) * sizeof(char));
+    if (copy == NULL) return NULL;
+    if (!(ht->flags & HT_POOLED)) ht_count(ht, &ht->counters.allocations, 1);
+
+    memcpy(copy, key, length);
+    copy[length] = '\0';
+    return copy;
+}
+
+void ht_key_free(table *ht, char *key)
+{
+    // Arena keys are only given back all at once, by pool_release.
+    if (!(ht->flags & HT_POOLED)) free(key);
+}
+
+static sllnode *ht_node_alloc(table *ht)
+{
+    if (ht->flags & HT_POOLED) return pool_node_alloc(&ht->pool);
+
+    ht_count(ht, &ht->counters.allocations, 1);
+    return malloc(ht_node_bytes(ht) + ht->value_size);
+}
+
+static void ht_node_free(table *ht, sllnode *node)
+{
+    if (ht->flags & HT_POOLED) 
+        pool_node_free(&ht->pool, node);
+    else
+        free(node);
+}
+
+/**
+ * @brief Move up to <nbuckets> linked lists from the old array to the new.
+ * @note This is what spreads a resize across many calls instead of one.
+ */
+static void ht_rehash_step(table *ht, int nbuckets)
+{
+    // Don't let a long run of empty old buckets make this call slow either.
+    size_t empty_visits = (size_t)nbuckets * 10;
+
+    while (nbuckets > 0 && ht->rehash_idx < (size_t)ht->old_size)
+    {
+        sllnode *tmp = ht->old_elements[ht->rehash_idx];
+        if (tmp == NULL)
+        {
+            ht->rehash_idx++;
+            if (--empty_visits == 0) break;
+            continue;
+        }
+
+        while (tmp != NULL)
+        {
+            sllnode *next = tmp->next;
+            size_t idx = ht_bucket(tmp->hash, ht->size);
+            tmp->next = ht->elements[idx];
+            ht->elements[idx] = tmp;
+            if (ht->flags & HT_BLOOM) bloom_moved(ht, tmp->hash);
+            tmp = next;
+        }
+        ht->old_elements[ht->rehash_idx++] = NULL;
+        nbuckets--;
+    }
+
+    // Every old linked list has been moved, we're done with the old array.
+    if (ht->rehash_idx == (size_t)ht->old_size)
+    {
+        free(ht->old_elements);
+        ht->old_elements = NULL;
+        ht->old_size = 0;
+        ht->rehash_idx = 0;
+    }
+}
+
+// Stop-the-world fallback, only for when we can't afford to wait.
+void ht_rehash_finish(table *ht)
+{
+    while (ht_rehashing(ht)) 
+        ht_rehash_step(ht, ht->old_size);
+}
+
+/**
+ * @brief Start migrating to an array twice as big if we're over max load.
+ * @note If we can't get the memory we just keep using the current array.
+ */
+static void ht_maybe_grow(table *ht)
+{
+    // Lock-free readers can't cope with lists moving under them.
+    if (ht->flags & HT_CONCURRENT) return;
+    if ((double)ht->count <= (double)ht->size * ht->max_load) return;
+    if (ht->size >= HT_MAX_SIZE) return;
+
+    // Still busy with the last resize? Too bad, finish it right now.
+    ht_rehash_finish(ht);
+
+    sllnode **bigger = calloc(sizeof(sllnode*), (size_t)ht->size * 2);
+    if (bigger == NULL) return;
+    ht_count(ht, &ht->counters.allocations, 1);
+
+    ht->old_elements = ht->elements;
+    ht->old_size = ht->size;
+    ht->rehash_idx = 0;
+    ht->elements = bigger;
+    ht->size *= 2;
+
+    // Twice the lists soon means twice the entries, the filter grows too.
+    if (ht->flags & HT_BLOOM) bloom_resize(ht);
+}
+
+/**
+ * @brief Walk 1 linked list looking for <key>.
+ * @return Address of the pointer to <key>'s node, NULL if not found.
+ * @note Returning the link rather than the node lets us unlink it easily.
+ */
+static sllnode **chain_lookup(table *ht, sllnode **link, const char *key, 
+                              size_t length, uint64_t hash)
+{
+    uint64_t probes = 0, compares = 0;
+    for (sllnode *tmp = *link; tmp != NULL; tmp = *link)
+    {
+        probes++;
+        // Only compare bytes once both the hash and length agree.
+        if (tmp->hash == hash && tmp->length == length)
+        {
+            compares++;
+            if (memcmp(tmp->key, key, length) == 0) break;
+        }
+        link = &tmp->next;
+    }
+    ht_count_lookup(ht, probes, compares);
+    return (*link != NULL) ? link : NULL;
+}
+
+/**
+ * @brief Look for <key> in both arrays if we're in the middle of a resize.
+ * @return Address of the pointer to <key>'s node, NULL if not found.
+ */
+static sllnode **ht_lookup(table *ht, const char *key, size_t length, 
+                           uint64_t hash)
+{
+    if (ht_rehashing(ht))
+    {
+        // Only old linked lists that haven't been migrated yet count.
+        size_t old_idx = ht_bucket(hash, ht->old_size);
+        if (old_idx >= ht->rehash_idx)
+        {
+            sllnode **link = chain_lookup(ht, &ht->old_elements[old_idx], 
+                                          key, length, hash);
+            if (link != NULL) return link;
+        }
+    }
+    return chain_lookup(ht, &ht->elements[ht_bucket(hash, ht->size)], 
+                        key, length, hash);
 }
 
-table *ht_create(int size, hash_function *hf, cleanup_function *cf)
+// Inline values belong to the table, there's nothing to free by default.
+static void ht_noclean(void *obj)
+{
+    (void)obj;
+}
+
+table *ht_create(int size, hash_function *hf, cleanup_function *cf, unsigned flags)
+{
+    return ht_create_sized(size, 0, hf, cf, flags);
+}
+
+void ht_init_fields(table *ht, int size, unsigned flags, hash_function *hf,
+                    cleanup_function *cf, size_t value_size)
+{
+    // Anything not set below starts out 0 or NULL, new fields included.
+    memset(ht, 0, sizeof(*ht));
+    ht->size = size;
+    ht->flags = flags;
+    ht->max_load = HT_DEFAULT_MAX_LOAD;
+    ht->hash_fn = (hf == NULL) ? ht_hash_fast : hf;
+
+    // Ternary operator is useful for conditional variable assignment
+    ht->clean_fn = (cf != NULL) ? cf : (value_size != 0) ? ht_noclean : free;
+    ht->value_size = value_size;
+    pool_init(&ht->pool, ht_node_bytes(ht) + value_size);
+    cache_init(ht);
+    bloom_init(ht);
+}
+
+table *ht_create_sized(int size, size_t value_size, hash_function *hf, 
+                       cleanup_function *cf, unsigned flags)
 {
     // sizeof(table) is unknown at due to <table> being an opaque struct.
     // Use sizeof on the object that <ht> is pointing at for this case.
+    // Readers never lock, so they can't follow entries that move around.
+    if ((flags & HT_CONCURRENT) && (flags & (HT_OPEN_ADDRESSING | HT_POOLED)))
+    {
+        printf("HT_CONCURRENT only works with plain HT_CHAINED tables!\n");
+        return NULL;
+    }
+    // Nor can they read a value while a writer copies over it.
+    if ((flags & HT_CONCURRENT) && value_size != 0)
+    {
+        printf("HT_CONCURRENT tables can't store values inline!\n");
+        return NULL;
+    }
+    // Nor set filter bits while readers test them.
+    if ((flags & HT_CONCURRENT) && (flags & HT_BLOOM))
+    {
+        printf("HT_CONCURRENT tables can't have a Bloom filter!\n");
+        return NULL;
+    }
+    // Evicting relinks nodes, which neither of those can spare.
+    if ((flags & HT_CACHE) && (flags & (HT_OPEN_ADDRESSING | HT_CONCURRENT)))
+    {
+        printf("HT_CACHE only works with HT_CHAINED tables!\n");
+        return NULL;
+    }
+
     table *ht = malloc(sizeof(*ht));
     if (ht == NULL) 
     {
         printf("Failed to allocate memory for hashtable!\n");
         return NULL;
     }
-    ht->size = size;
+    ht_init_fields(ht, size, flags, hf, cf, value_size);
+
+    if (flags & HT_OPEN_ADDRESSING)
+    {
+        if (!oa_init(ht, size))
+        {
+            bloom_destroy(ht);
+            free(ht);
+            printf("Failed to allocate memory for hashtable's slots!\n");
+            return NULL;
+        }
+        return ht;
+    }
+
+    // Power of 2 so we can mask the hash instead of using modulo.
+    ht->size = 8;
+    while (ht->size < size && ht->size < HT_MAX_SIZE) ht->size *= 2;
 
     // calloc will 0 out the memory, useful for large list like this
     ht->elements = calloc(sizeof(sllnode*), ht->size);
     if (ht->elements == NULL)
     {
+        bloom_destroy(ht);
         free(ht);
         printf("Failed to allocate memory for hashtable's elements!\n");
         return NULL;        
     }
-    ht->collisions = 0;
-    ht->hash_fn = hf;
-    
-    // Ternary operator is useful for conditional variable assignment
-    ht->clean_fn = (cf == NULL) ? free : cf;
+    ht_count(ht, &ht->counters.allocations, 1);
+
+    if ((flags & HT_CONCURRENT) && !cc_init(ht))
+    {
+        free(ht->elements);
+        free(ht);
+        printf("Failed to allocate memory for hashtable's locks!\n");
+        return NULL;
+    }
     return ht;
 }
 
-void ht_destroy(table *ht)
+/**
+ * @brief Clean up every object in <size> linked lists and free the nodes.
+ * @note Pooled nodes and keys are left alone, pool_release frees them
+ * a whole slab at a time.
+ */
+static void ht_free_lists(table *ht, sllnode **elements, int size)
 {
-    if (ht == NULL) return;
+    bool pooled = (ht->flags & HT_POOLED) != 0;
 
     // Get a handle to each linked individual linked list first.
-    for (int i = 0; i < ht->size; i++)
+    for (int i = 0; i < size; i++)
     {
         // Traverse the linked list and free each element.
-        sllnode *tmp = ht->elements[i];
+        sllnode *tmp = elements[i];
         while (tmp != NULL)
         {
             sllnode *next = tmp->next;
             ht->clean_fn(tmp->obj);
-            free(tmp->key);
-            free(tmp);
+            if (!pooled)
+            {
+                free(tmp->key);
+                free(tmp);
+            }
             tmp = next;
         }
     }
+}
+
+void ht_destroy(table *ht)
+{
+    if (ht == NULL) return;
+
+    if (ht->flags & HT_MAPPED)
+    {
+        map_close(ht);
+        free(ht);
+        return;
+    }
+    bloom_destroy(ht);
+    if (ht->flags & HT_OPEN_ADDRESSING)
+    {
+        oa_destroy(ht);
+        pool_release(&ht->pool);
+        free(ht);
+        return;
+    }
+
+    // Don't lose the linked lists that are still in the old array.
+    if (ht_rehashing(ht))
+    {
+        ht_free_lists(ht, ht->old_elements, ht->old_size);
+        free(ht->old_elements);
+    }
+    ht_free_lists(ht, ht->elements, ht->size);
+    if (ht->flags & HT_CONCURRENT) cc_destroy(ht);
+
     // ptr to linked lists and table itself were dynamically allocated also
     free(ht->elements);
+    pool_release(&ht->pool);
     free(ht);
 }
 
 void ht_print(table *ht)
 {
     if (ht == NULL) return;
+    if (ht->flags & HT_MAPPED) 
+    {
+        map_print(ht);
+        return;
+    }
+    if (ht->flags & HT_OPEN_ADDRESSING) 
+    {
+        oa_print(ht);
+        return;
+    }
+    // Printing is O(n) anyway, so it may as well show the final layout.
+    ht_rehash_finish(ht);
 
     int empty_lists = 0;
     printf("---- START TABLE ----\n");
@@ -139,23 +402,47 @@ uint64_t ht_collisions(table *ht)
     return ht->collisions;
 }
 
-bool ht_insert(table *ht, const char *key, void *obj)
+bool ht_set_max_load(table *ht, double max_load)
 {
-    // Need to dereference <ht> and <key>, so check beforehand.
-    if (ht == NULL || key == NULL || obj == NULL) return false;
+    if (ht == NULL || !(max_load > 0.0)) return false;
+    if (ht->flags & HT_MAPPED) return false;
 
-    size_t idx = ht_hash(ht, key);
+    ht->max_load = max_load;
+    if (!(ht->flags & HT_OPEN_ADDRESSING)) ht_maybe_grow(ht);
+    return true;
+}
 
-    // Don't reinsert an object with this exact key if it already exists.
-    if (ht_find(ht, key) != NULL) return false;
+// ht_probe_hashed for chained tables, same contract.
+static void **chain_probe(table *ht, const char *key, size_t length,
+                          uint64_t hash, bool insert, bool *inserted)
+{
+    if (ht_rehashing(ht)) ht_rehash_step(ht, REHASH_STEP);
+
+    sllnode **link = ht_lookup(ht, key, length, hash);
+    if (link != NULL)
+    {
+        if (ht->flags & HT_CACHE) cache_touch(ht, *link);
+        return &(*link)->obj;
+    }
+    if (!insert) return NULL;
 
     // Create new sllnode to be inserted.
-    sllnode *tmp = malloc(sizeof(*tmp));
-    if (tmp == NULL) return false;
+    sllnode *tmp = ht_node_alloc(ht);
+    if (tmp == NULL) return NULL;
+
+    // Inline values live right after the node, so obj always points there.
+    tmp->obj = ht_value_init(ht, ht_node_value(ht, tmp));
+    tmp->key = ht_key_copy(ht, key, length);
+    if (tmp->key == NULL)
+    {
+        ht_node_free(ht, tmp);
+        return NULL;
+    }
+    tmp->hash = hash;
+    tmp->length = length;
 
-    tmp->obj = obj;
-    tmp->key = malloc((strlen(key) + 1) * sizeof(char));
-    strcpy(tmp->key, key);
+    // New entries always go to the newest array.
+    size_t idx = ht_bucket(hash, ht->size);
 
     // Update collision count if this index is occupied beforehand.
     if (ht->elements[idx] != NULL) ht->collisions++;
@@ -163,55 +450,231 @@ bool ht_insert(table *ht, const char *key, void *obj)
     // Usual linked list rearrangement
     tmp->next = ht->elements[idx];
     ht->elements[idx] = tmp;
+    ht->count++;
+
+    // Nodes never move when we grow, so <&tmp->obj> stays valid.
+    ht_maybe_grow(ht);
+
+    // Nor when others are evicted to make room, <tmp> never is.
+    if (ht->flags & HT_CACHE) cache_admit(ht, tmp);
+
+    *inserted = true;
+    return &tmp->obj;
+}
+
+void **ht_probe_hashed(table *ht, const char *key, size_t length,
+                       uint64_t hash, bool insert, bool *inserted)
+{
+    // Nothing to hand out a writable obj pointer to in a mapped file.
+    if (ht->flags & HT_MAPPED) return NULL;
+    if (!(ht->flags & HT_BLOOM))
+    {
+        return (ht->flags & HT_OPEN_ADDRESSING)
+            ? oa_probe(ht, key, length, hash, insert, inserted)
+            : chain_probe(ht, key, length, hash, insert, inserted);
+    }
+
+    // A new key has to be looked for anyway, we may already have it.
+    if (!insert && !bloom_maybe(ht, hash)) return NULL;
+
+    bool added = false;
+    void **slot = (ht->flags & HT_OPEN_ADDRESSING)
+        ? oa_probe(ht, key, length, hash, insert, &added)
+        : chain_probe(ht, key, length, hash, insert, &added);
+    if (added)
+    {
+        bloom_add(ht, hash);
+        *inserted = true;
+    }
+    else if (slot == NULL && !insert)
+    {
+        ht->bloom.false_positives++;
+    }
+    return slot;
+}
+
+// Same as ht_probe_hashed, for when we haven't hashed <key> yet.
+static void **ht_probe(table *ht, const char *key, size_t length, 
+                       bool insert, bool *inserted)
+{
+    return ht_probe_hashed(ht, key, length, ht_hash(ht, key, length), 
+                           insert, inserted);
+}
+
+bool ht_insert(table *ht, const char *key, void *obj)
+{
+    if (key == NULL) return false;
+    return ht_insert_n(ht, key, strlen(key), obj);
+}
+
+bool ht_insert_n(table *ht, const char *key, size_t length, void *obj)
+{
+    // Need to dereference <ht> and <key>, so check beforehand.
+    if (ht == NULL || key == NULL || obj == NULL) return false;
+    if (ht->flags & HT_CONCURRENT) 
+        return cc_insert(ht, key, length, ht_hash(ht, key, length), obj);
+
+    // Don't reinsert an object with this exact key if it already exists.
+    bool inserted = false;
+    void **slot = ht_probe(ht, key, length, true, &inserted);
+    if (slot == NULL || !inserted) return false;
+
+    ht_store(ht, slot, obj);
     return true;
 }
 
+void **ht_find_or_insert(table *ht, const char *key, bool *inserted)
+{
+    if (ht == NULL || key == NULL || inserted == NULL) return NULL;
+
+    // Nobody could fill in the new obj safely while readers are looking.
+    // Inline values aren't obj pointers you could set, see ht_emplace.
+    if ((ht->flags & HT_CONCURRENT) || ht->value_size != 0) return NULL;
+
+    *inserted = false;
+    return ht_probe(ht, key, strlen(key), true, inserted);
+}
+
+void *ht_emplace(table *ht, const char *key, bool *inserted)
+{
+    if (ht == NULL || key == NULL || inserted == NULL) return NULL;
+    if (ht->value_size == 0) return NULL;
+
+    *inserted = false;
+    void **slot = ht_probe(ht, key, strlen(key), true, inserted);
+    return (slot != NULL) ? *slot : NULL;
+}
+
+void **ht_upsert(table *ht, const char *key, void *obj)
+{
+    if (ht == NULL || key == NULL || obj == NULL) return NULL;
+    if (ht->value_size != 0) return NULL;
+    if (ht->flags & HT_CONCURRENT) return NULL;
+
+    bool inserted = false;
+    void **slot = ht_probe(ht, key, strlen(key), true, &inserted);
+    if (slot == NULL) return NULL;
+
+    // Don't free the object we're about to store, in case it's the same one.
+    if (!inserted && *slot != obj) ht->clean_fn(*slot);
+    ht_store(ht, slot, obj);
+    return slot;
+}
+
+void **ht_replace(table *ht, const char *key, void *obj)
+{
+    if (ht == NULL || key == NULL || obj == NULL) return NULL;
+    if (ht->value_size != 0) return NULL;
+    if (ht->flags & HT_CONCURRENT) return NULL;
+
+    void **slot = ht_probe(ht, key, strlen(key), false, NULL);
+    if (slot == NULL) return NULL;
+
+    if (*slot != obj) ht->clean_fn(*slot);
+    ht_store(ht, slot, obj);
+    return slot;
+}
+
+bool ht_set(table *ht, const char *key, void *obj, bool replace_only)
+{
+    if (ht == NULL || key == NULL || obj == NULL) return false;
+    if (ht->flags & HT_CONCURRENT)
+        return cc_upsert(ht, key, strlen(key), ht_hash(ht, key, strlen(key)),
+                         obj, replace_only);
+
+    return ((replace_only) ? ht_replace(ht, key, obj)
+                           : ht_upsert(ht, key, obj)) != NULL;
+}
+
 void *ht_find(table *ht, const char *key)
 {
-    if (ht == NULL || key == NULL) return NULL;
+    if (key == NULL) return NULL;
+    return ht_find_n(ht, key, strlen(key));
+}
 
-    size_t idx = ht_hash(ht, key);
-    sllnode *tmp = ht->elements[idx];
+void *ht_find_n(table *ht, const char *key, size_t length)
+{
+    if (ht == NULL || key == NULL) return NULL;
+    if (ht->flags & HT_CONCURRENT) 
+        return cc_find(ht, key, length, ht_hash(ht, key, length));
+    if (ht->flags & HT_MAPPED) 
+        return map_find(ht, key, length, ht_hash(ht, key, length));
 
-    /*  Keep looking if the list is still valid and we haven't found the matching key */
-    while (tmp != NULL && strcmp(tmp->key, key) != 0)
+    void **slot = ht_probe(ht, key, length, false, NULL);
+    if (ht->flags & HT_CACHE)
     {
-        tmp = tmp->next;
-    } 
+        if (slot != NULL) ht->cache.hits++;
+        else ht->cache.misses++;
+    }
+
     /*  Could not find the obj */
-    if (tmp == NULL) return NULL;
+    if (slot == NULL) return NULL;
+
+    return *slot;
+}
+
+/**
+ * @brief Take the node at <*link> out of its linked list and free it.
+ * @note Its obj goes to the cleanup function, same as on destroy.
+ */
+static void ht_unlink(table *ht, sllnode **link)
+{
+    // Point whatever pointed at <tmp>, list head or not, past it.
+    sllnode *tmp = *link;
+    *link = tmp->next;
+    ht->count--;
+    if (ht->flags & HT_CACHE) cache_forget(ht, tmp);
+    if (ht->flags & HT_BLOOM) bloom_forget(ht);
 
-    return tmp->obj;
+    // Main assumption: all of these were probably dynamically allocated
+    ht->clean_fn(tmp->obj);
+    ht_key_free(ht, tmp->key);
+    ht_node_free(ht, tmp);
 }
 
 bool ht_delete(table *ht, const char *key)
 {
-    if (ht == NULL || key == NULL) return false;
+    if (key == NULL) return false;
+    return ht_delete_n(ht, key, strlen(key));
+}
 
-    size_t idx = ht_hash(ht, key);
-    sllnode *tmp = ht->elements[idx];
-    sllnode *prev = NULL;
+bool ht_delete_n(table *ht, const char *key, size_t length)
+{
+    if (ht == NULL || key == NULL) return false;
+    if (ht->flags & HT_MAPPED) return false;
 
-    // Traverse list until we find the key or we reach the end of the list
-    while (tmp != NULL && strcmp(tmp->key, key) != 0)
+    uint64_t hash = ht_hash(ht, key, length);
+    if (ht->flags & HT_OPEN_ADDRESSING)
     {
-        prev = tmp;
-        tmp = tmp->next;
+        if (!oa_delete(ht, key, length, hash)) return false;
+        if (ht->flags & HT_BLOOM) bloom_forget(ht);
+        return true;
     }
+    if (ht->flags & HT_CONCURRENT) 
+        return cc_delete(ht, key, length, hash);
+
+    if (ht_rehashing(ht)) ht_rehash_step(ht, REHASH_STEP);
+
+    sllnode **link = ht_lookup(ht, key, length, hash);
 
     // Could not find the obj :(
-    if (tmp == NULL) return false;
-    
-    // Deleting list head, so rearrange head of the list
-    if (prev == NULL) 
-        ht->elements[idx] = tmp->next;
-    // Deleting from anywhere not list head, so rearrange middle of the list
-    else 
-        prev->next = tmp->next;
+    if (link == NULL) return false;
 
-    // Main assumption: all of these were probably dynamically allocated
-    ht->clean_fn(tmp->obj);
-    free(tmp->key);
-    free(tmp);
+    ht_unlink(ht, link);
     return true;
-}
\ No newline at end of file
+}
+
+void ht_evict(table *ht, sllnode *node)
+{
+    ht_unlink(ht, ht_lookup(ht, node->key, node->length, node->hash));
+}
+
+void ht_pin(table *ht)
+{
+    if (ht != NULL && (ht->flags & HT_CONCURRENT)) cc_pin(ht);
+}
+
+void ht_unpin(table *ht)
+{
+    if (ht != NULL && (ht->flags & HT_CONCURRENT)) cc_unpin(ht);
+}
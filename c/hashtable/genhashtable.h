@@ -16,13 +16,34 @@
 /**
  * @brief Actual implementation of the hash function is up to you.
  * @brief It's meant to be a member of the hashtable struct.
- * @param key the NUL terminated string you want to use as the key.
+ * @param key the string you want to use as the key, may hold any bytes.
  * @param length the string's length. Use strlen or similar.
  * @return uint64_t for your hashed value.
  * @note The parameters must always be the same.
+ * @note Pass NULL for hf in ht_create to default to ht_hash_fast.
   */
 typedef uint64_t hash_function(const char *key, size_t length);
 
+/**
+ * @brief Built-in hash functions you can pass as hf to ht_create.
+ * @note ht_hash_wyhash is wyhash: fast, and well spread in every bit.
+ * @note ht_hash_fast uses the CPU's CRC32C instruction if it has one, else
+ * it's ht_hash_wyhash. Which one is decided once, at startup.
+ * @note ht_hash_seeded is wyhash with a seed picked at random at startup,
+ * so keys can't be crafted ahead of time to all collide. Hashes differ
+ * between runs, so don't save them anywhere.
+ */
+uint64_t ht_hash_wyhash(const char *key, size_t length);
+uint64_t ht_hash_fast(const char *key, size_t length);
+uint64_t ht_hash_seeded(const char *key, size_t length);
+
+/**
+ * @brief Replace the random seed of ht_hash_seeded, e.g. to reproduce a run.
+ * @param seed Any 64 bit value.
+ * @note Call it before creating any table that uses ht_hash_seeded.
+ */
+void ht_hash_set_seed(uint64_t seed);
+
 /**
  * @brief The function to be called to free your object.
  * @brief It's meant to be a member of the hashtable struct.
@@ -32,28 +53,179 @@ typedef uint64_t hash_function(const char *key, size_t length);
   */
 typedef void cleanup_function(void *obj);
 
+/**
+ * @brief Turns your object into bytes for ht_save, like snprintf does.
+ * @param obj The object to serialize, same one you inserted.
+ * @param buf Where to write the bytes, may be NULL if <size> is 0.
+ * @param size # of bytes <buf> has room for.
+ * @return # of bytes <obj> needs, whether or not <size> was big enough.
+ * @note Only write to <buf> if the return value fits in <size>.
+  */
+typedef size_t serialize_function(const void *obj, void *buf, size_t size);
+
+/**
+ * @brief How many bytes <obj> costs a HT_CACHE table, see ht_set_cache.
+ * @param obj The object to weigh, same one you inserted.
+ * @return # of bytes to charge for it, on top of the table's own.
+  */
+typedef size_t cost_function(const void *obj);
+
 /**
  * @brief A generic hashtable.
  * @note Forward declared in genhashtable.h as an opaque struct.
  * @note Actual implementation is in the genhashtable.c file.
   */
 typedef struct generic_hashtable table;
-    
+
+/**
+ * @brief Flags for ht_create, OR them together.
+ * @note HT_CHAINED is the default: an array of singly-linked lists.
+ * @note HT_OPEN_ADDRESSING stores entries in 1 flat array instead and probes
+ * 16 slots at a time by their hash fragments. It grows on its own, but
+ * in 1 go rather than a few buckets per call like chained tables do.
+ * @note HT_POOLED carves nodes out of big slabs and copies keys into a bump
+ * arena instead of 2 mallocs per entry. Deleted nodes get reused, but a
+ * deleted key's bytes are only given back by ht_destroy.
+ * @note HT_CONCURRENT makes insert/find/delete/set thread-safe.
+ * Writers lock a stripe of buckets, ht_find takes no locks at all. Deleted
+ * objects only reach the cleanup function once no ht_find can still see
+ * them. Only for chained, non-pooled tables, and they never grow.
+ * @note HT_COUNTERS makes the table count every lookup, how many nodes (or
+ * slot groups) it probed, how many keys it compared and how many times it
+ * called malloc. See ht_stats. It costs a little on every call.
+ * @note HT_UNIQUE_KEYS is only for ht_build_parallel, see there.
+ * @note HT_CACHE makes the table evict entries once it goes over a budget,
+ * see ht_set_cache. Only for chained tables, and not HT_CONCURRENT ones.
+ * @note HT_BLOOM puts a Bloom filter in front of the table, so most lookups
+ * of missing keys cost 1 cache line instead of a whole chain or probe.
+ * 4 to 8 more bytes per entry right after the filter is sized, down to 2
+ * as the table fills it, and up to twice that while a bigger one is being
+ * filled. Not for HT_CONCURRENT tables.
+ */
+#define HT_CHAINED          0x0
+#define HT_OPEN_ADDRESSING  0x1
+#define HT_POOLED           0x2
+#define HT_CONCURRENT       0x4
+#define HT_COUNTERS         0x8
+#define HT_UNIQUE_KEYS      0x10
+#define HT_CACHE            0x20
+#define HT_BLOOM            0x40
+
+/**
+ * @brief Eviction policies for ht_set_cache.
+ * @note HT_EVICT_LRU evicts whatever was used longest ago. Exact, but every
+ * hit moves its entry to the front of a list.
+ * @note HT_EVICT_SIEVE only marks an entry on a hit. Evicting sweeps from
+ * the oldest entry on, giving marked ones another round. Cheaper hits, and
+ * usually as many or more of them than LRU.
+ */
+#define HT_EVICT_LRU        0
+#define HT_EVICT_SIEVE      1
+
+// Buckets of the histogram in struct ht_stats.
+#define HT_STATS_CHAINS 16
+
+/**
+ * @brief What ht_stats found out about a table.
+ * @note <chains> counts linked lists by their length for chained tables:
+ * chains[0] is the # of empty lists, chains[1] the # with 1 entry, etc.
+ * For open addressing tables, it counts entries by how many slot groups a
+ * lookup probes to find them, so chains[0] is always 0.
+ * The last one also counts everything longer.
+ * @note <lookups>, <probes>, <compares> and <allocations> add up since
+ * ht_create, and are only counted for HT_COUNTERS tables. Otherwise 0.
+ * @note <hits>, <misses> and <evictions> are only counted for HT_CACHE
+ * tables, always. Hits and misses are ht_find and ht_find_batch results.
+ * @note <filtered>, <false_positives> and <false_positive_rate> are only
+ * counted for HT_BLOOM tables. <false_positive_rate> is the share of
+ * lookups for missing keys that the filter let through anyway.
+  */
+struct ht_stats
+{
+    size_t count;                   // # of entries.
+    size_t buckets;                 // # of linked lists, or slots.
+    double load_factor;             // count / buckets.
+    size_t empty_buckets;           // # of empty linked lists or slots.
+    size_t max_chain;               // Longest list, or longest probe.
+    size_t chains[HT_STATS_CHAINS]; // See above.
+    size_t bytes;                   // Roughly what the table has malloc'd.
+
+    uint64_t lookups;               // # of times a key was looked for.
+    uint64_t probes;                // # of nodes or slot groups visited.
+    uint64_t compares;              // # of key comparisons (memcmp).
+    uint64_t allocations;           // # of malloc calls for the table.
+
+    uint64_t hits;                  // # of lookups that found their key.
+    uint64_t misses;                // # of lookups that didn't.
+    uint64_t evictions;             // # of entries evicted to stay in budget.
+
+    uint64_t filtered;              // # of misses the Bloom filter answered.
+    uint64_t false_positives;       // # of misses it couldn't rule out.
+    double false_positive_rate;     // See above.
+};
+
 /**
  * @brief Initialize your table and return a handle to it.
- * @param size How many indexes/linked lists you want in the table.
+ * @param size How many indexes/linked lists you want in the table to start.
+ * Rounded up to a power of 2, the table grows on its own past max load.
+ * Neither goes past 2^30 buckets, the table just gets fuller after that.
  * @param hf Custom hash function. See hash_function in genhashtable.h.
+ * Pass NULL for ht_hash_fast, or one of the other ht_hash_* built-ins.
  * @param cf Custom cleanup function for your object type. Pass NULL for free().
+ * @param flags HT_CHAINED, or one of the other HT_* flags to pick a backend.
  * @return A pointer to your table on success, NULL otherwise.
  * @note This will malloc space for your table. Remember to free it later on.
  * @note cf can be specific to cleanup custom datatypes.
  */
-table *ht_create(int size, hash_function *hf, cleanup_function *cf);
+table *ht_create(int size, hash_function *hf, cleanup_function *cf, unsigned flags);
+
+/**
+ * @brief Same as ht_create, but every entry holds a <value_size> byte value
+ * inline, in the table's own memory, instead of a pointer to your object.
+ * @param size Same as ht_create.
+ * @param value_size # of bytes in each value, 0 makes this ht_create.
+ * @param hf Same as ht_create.
+ * @param cf Optional, called on the address of each value before it goes
+ * away, for values that own something. It mustn't free the address itself.
+ * @param flags Same as ht_create, except for HT_CONCURRENT.
+ * @return A pointer to your table on success, NULL otherwise.
+ * @note ht_insert copies <value_size> bytes from obj, so obj may be the
+ * address of a local. ht_find returns the address of the stored copy,
+ * aligned to 8 bytes and valid until the next insert or delete.
+ * @note ht_find_or_insert, ht_upsert and ht_replace return NULL on these
+ * tables, and ht_set false. Use ht_emplace and write through the pointer.
+ */
+table *ht_create_sized(int size, size_t value_size, hash_function *hf, 
+                       cleanup_function *cf, unsigned flags);
+
+/**
+ * @brief Create a table and fill it with <n> entries, using many threads.
+ * @param keys <n> NUL terminated string keys, none of them NULL.
+ * @param objs <n> objects, same rules as ht_insert.
+ * @param n # of entries.
+ * @param nthreads # of threads to use, including this one.
+ * @param hf, cf, flags Same as ht_create. Add HT_UNIQUE_KEYS if you know
+ * no 2 keys are the same, to skip checking for duplicates.
+ * @param inserted Optional, gets <n> results, same as ht_insert's.
+ * @return A pointer to your table on success, NULL otherwise.
+ * @note Same result as ht_create then ht_insert on every entry in order,
+ * so for duplicate keys the first one wins. You keep the other objs.
+ * @note With HT_UNIQUE_KEYS and duplicate keys anyway, every one of them is
+ * inserted but only 1 can ever be found. Don't.
+ * @note On NULL you keep every obj, none of them were cleaned up.
+ * @note Open addressing and HT_CACHE tables are filled by 1 thread, with
+ * ht_insert_batch.
+ */
+table *ht_build_parallel(const char **keys, void **objs, size_t n,
+                         int nthreads, hash_function *hf, cleanup_function *cf,
+                         unsigned flags, bool *inserted);
 
 /**
  * @brief Frees your entire table and each of its linked lists.
  * @param ht The pointer to the hashtable you wish to free.
  * @note This assumes each entry has a malloc'd key and malloc'd obj.
+ * @note HT_POOLED tables still call the cleanup function on every obj,
+ * but free their nodes and keys a whole slab at a time.
   */
 void ht_destroy(table *ht);
 
@@ -72,6 +244,51 @@ void ht_print(table *ht);
   */
 uint64_t ht_collisions(table *ht);
 
+/**
+ * @brief Walk the whole table and fill in <stats>.
+ * @param ht The pointer to the hashtable you want to check.
+ * @param stats Where to put the results, see struct ht_stats.
+ * @return true if successful, false if either pointer is <NULL>.
+ * @note O(n), so call it now and then, not on every lookup.
+ * @note Safe on HT_CONCURRENT tables, but writers running meanwhile make
+ * the numbers a little off.
+  */
+bool ht_stats(table *ht, struct ht_stats *stats);
+
+/**
+ * @brief Set how full the table may get before it grows.
+ * @param ht The pointer to the hashtable you want to tune.
+ * @param max_load Average # of entries per linked list, 1.0 by default.
+ * @return true if successful, false if <ht> is <NULL> or max_load <= 0.
+ * @note Growing doubles the # of linked lists, but the entries are moved
+ * over a few lists at a time by later ht_insert/ht_find/ht_delete calls.
+ * @note Open addressing tables never go above 7/8 no matter what you pass.
+ * They also resize all at once: the insert that grows one rehashes every
+ * slot before it returns, so that 1 call costs O(n).
+  */
+bool ht_set_max_load(table *ht, double max_load);
+
+/**
+ * @brief Give a HT_CACHE table its budget and eviction policy.
+ * @param ht Pointer to a hashtable created with HT_CACHE.
+ * @param max_entries Most entries to keep, 0 for no limit.
+ * @param max_bytes Most bytes to keep, 0 for no limit. Each entry costs its
+ * node, key and inline value, plus whatever <cost> says its obj does.
+ * @param policy HT_EVICT_LRU or HT_EVICT_SIEVE.
+ * @param cost Optional, how many bytes each obj costs on top of that.
+ * @return true if successful, false if <ht> isn't a HT_CACHE table or
+ * <policy> is unknown.
+ * @note Until this is called, a HT_CACHE table has no limits and uses
+ * HT_EVICT_SIEVE. Entries over a new, smaller budget are evicted right away.
+ * @note Evicted objs go to the table's cleanup function, like deleted ones.
+ * Every insert may evict, but never the entry it just stored.
+ * @note ht_find counts as a use. It never allocates, on a hit or otherwise.
+ * @note An obj stored through ht_find_or_insert's pointer isn't weighed by
+ * <cost>, use ht_insert or ht_upsert for that.
+  */
+bool ht_set_cache(table *ht, size_t max_entries, size_t max_bytes,
+                  unsigned policy, cost_function *cost);
+
 /**
  * @brief Insert obj into the hashtable using the given key.
  * @param ht Pointer to the hashtable where the object will be inserted.
@@ -82,6 +299,17 @@ uint64_t ht_collisions(table *ht);
   */
 bool ht_insert(table *ht, const char *key, void *obj);
 
+/**
+ * @brief Same as ht_insert, but for a key of exactly <length> bytes.
+ * @param ht Pointer to the hashtable where the object will be inserted.
+ * @param key Object's key, doesn't need to be NUL terminated.
+ * @param length # of bytes in <key>, they may include '\0'.
+ * @param obj A void pointer, can point to any datatype.
+ * @return true if successful, false otherwise.
+ * @note Saves the strlen ht_insert does on every call.
+  */
+bool ht_insert_n(table *ht, const char *key, size_t length, void *obj);
+
 /**
  * @brief Tries to find an object in the hashtable using the given key.
  * @param ht Pointer to hashtable in which the element should be located.
@@ -90,6 +318,103 @@ bool ht_insert(table *ht, const char *key, void *obj);
   */
 void *ht_find(table *ht, const char *key);
 
+/**
+ * @brief Find the entry for <key>, adding an empty one if there is none.
+ * @param ht Pointer to the hashtable to look in.
+ * @param key Object's NUL terminated string key to be hashed.
+ * @param inserted Set to true if the entry is new, false if it existed.
+ * @return Address of the entry's obj pointer, NULL if we ran out of memory.
+ * @note The key is hashed once and its list walked once, even on insert.
+ * @note A new entry's obj is NULL. Store a real object through the returned
+ * pointer before you call anything else on this table.
+ * @note The pointer is only valid until the next insert or delete.
+ * @note Always NULL for HT_CONCURRENT tables, use ht_set there instead.
+ * @note Always NULL for ht_create_sized tables, use ht_emplace there instead.
+  */
+void **ht_find_or_insert(table *ht, const char *key, bool *inserted);
+
+/**
+ * @brief ht_find_or_insert for ht_create_sized tables.
+ * @param ht Pointer to a hashtable made by ht_create_sized.
+ * @param key Object's NUL terminated string key to be hashed.
+ * @param inserted Set to true if the entry is new, false if it existed.
+ * @return Address of the entry's inline value, NULL if we ran out of memory
+ * or <ht> doesn't store values inline.
+ * @note A new entry's value is all 0 bytes, e.g. a counter that starts at 0.
+ * @note The pointer is only valid until the next insert or delete.
+  */
+void *ht_emplace(table *ht, const char *key, bool *inserted);
+
+/**
+ * @brief Insert obj, or replace the obj already stored under <key>.
+ * @param ht Pointer to the hashtable where the object will be stored.
+ * @param key Object's NUL terminated string key to be hashed.
+ * @param obj A void pointer, can point to any datatype.
+ * @return Address of the entry's obj pointer, NULL if unsuccessful.
+ * @note A replaced obj is passed to the table's cleanup function.
+ * @note The pointer is only valid until the next insert or delete.
+ * @note Always NULL for HT_CONCURRENT tables, use ht_set there instead.
+  */
+void **ht_upsert(table *ht, const char *key, void *obj);
+
+/**
+ * @brief Replace the obj stored under <key>, only if <key> already exists.
+ * @param ht Pointer to the hashtable where the object will be stored.
+ * @param key Object's NUL terminated string key to be hashed.
+ * @param obj A void pointer, can point to any datatype.
+ * @return Address of the entry's obj pointer, NULL if <key> wasn't found.
+ * @note The replaced obj is passed to the table's cleanup function.
+ * @note The pointer is only valid until the next insert or delete.
+ * @note Always NULL for HT_CONCURRENT tables, use ht_set there instead.
+  */
+void **ht_replace(table *ht, const char *key, void *obj);
+
+/**
+ * @brief ht_upsert, or ht_replace if <replace_only>, without the pointer.
+ * @param ht Pointer to the hashtable where the object will be stored.
+ * @param key Object's NUL terminated string key to be hashed.
+ * @param obj A void pointer, can point to any datatype.
+ * @param replace_only Leave the table alone if <key> isn't in it yet.
+ * @return true if <obj> was stored, false otherwise.
+ * @note On HT_CONCURRENT tables, the replaced obj only reaches the cleanup
+ * function once no ht_find can still see it. Change an entry by storing a
+ * new obj, never by writing to the one you found.
+  */
+bool ht_set(table *ht, const char *key, void *obj, bool replace_only);
+
+/**
+ * @brief Same as ht_find, but for a key of exactly <length> bytes.
+ * @param ht Pointer to hashtable in which the element should be located.
+ * @param key Object's key, doesn't need to be NUL terminated.
+ * @param length # of bytes in <key>, they may include '\0'.
+ * @return Pointer to the object. Otherwise, NULL if not found in the list.
+  */
+void *ht_find_n(table *ht, const char *key, size_t length);
+
+/**
+ * @brief Look up <n> keys at once, overlapping their cache misses.
+ * @param ht Pointer to hashtable in which the elements should be located.
+ * @param keys <n> NUL terminated string keys, none of them NULL.
+ * @param n # of keys to look up.
+ * @param out Gets <n> results, same as ht_find would return for each key.
+ * @return # of keys that were found.
+ * @note Worth it once the table is much bigger than your CPU's caches.
+  */
+size_t ht_find_batch(table *ht, const char **keys, size_t n, void **out);
+
+/**
+ * @brief Insert <n> objects at once, overlapping their cache misses.
+ * @param ht Pointer to the hashtable where the objects will be inserted.
+ * @param keys <n> NUL terminated string keys, none of them NULL.
+ * @param objs <n> objects, same rules as ht_insert.
+ * @param n # of objects to insert.
+ * @param inserted Optional, gets <n> results, same as ht_insert's.
+ * @return # of objects that were inserted.
+ * @note You keep ownership of every obj that wasn't inserted.
+  */
+size_t ht_insert_batch(table *ht, const char **keys, void **objs, size_t n,
+                       bool *inserted);
+
 /**
  * @brief Frees memory for a specific element and its members.
  * @param ht Pointer to hashtable in which the element should be located.
@@ -98,4 +423,112 @@ void *ht_find(table *ht, const char *key);
   */
 bool ht_delete(table *ht, const char *key);
 
+/**
+ * @brief Same as ht_delete, but for a key of exactly <length> bytes.
+ * @param ht Pointer to hashtable in which the element should be located.
+ * @param key Object's key, doesn't need to be NUL terminated.
+ * @param length # of bytes in <key>, they may include '\0'.
+ * @return true if successful, false otherwise.
+  */
+bool ht_delete_n(table *ht, const char *key, size_t length);
+
+/**
+ * @brief Where an ht_iter_next loop is at. Set it up with ht_iter_begin.
+ * @note Fields are for genhashtable.c only, don't touch them.
+  */
+typedef struct ht_iter
+{
+    table *ht;
+    size_t idx;                     // Next linked list, slot or file offset.
+    void *next;                     // Next node in the current linked list.
+} ht_iter;
+
+/**
+ * @brief Start a walk over every entry of <ht>, in no particular order.
+ * @param ht Pointer to the hashtable to walk, any backend.
+ * @param it Where to keep track of the walk.
+ * @note A resize in progress is finished first, so the walk sees 1 array.
+ * @note In between ht_iter_next calls you may ht_find anything, and
+ * ht_delete the entry that was just returned. Anything else that inserts
+ * or deletes may move entries around under the walk, see ht_scan for that.
+ * @note On HT_CONCURRENT tables, ht_pin before and ht_unpin after.
+  */
+void ht_iter_begin(table *ht, ht_iter *it);
+
+/**
+ * @brief Step to the next entry of a walk started by ht_iter_begin.
+ * @param it The walk.
+ * @param key Optional, gets the entry's key. NUL terminated, but it may
+ * hold '\0' bytes of its own if it was inserted with a length.
+ * @param length Optional, gets the # of bytes in <key>.
+ * @param obj Optional, gets what ht_find would return for <key>.
+ * @return true if there was an entry, false once every entry has been seen.
+ * @note <key> belongs to the table, it's valid until the entry is deleted.
+  */
+bool ht_iter_next(ht_iter *it, const char **key, size_t *length, void **obj);
+
+/**
+ * @brief Called by ht_scan on every entry it finds.
+ * @param key, length, obj Same as ht_iter_next gives back.
+ * @param arg Whatever you passed to ht_scan.
+ * @note Don't insert into or delete from the table in here.
+  */
+typedef void scan_function(const char *key, size_t length, void *obj,
+                           void *arg);
+
+/**
+ * @brief Walk a slice of the table, picking up where the last call left off.
+ * @param ht Pointer to the hashtable to walk, any backend.
+ * @param cursor 0 to start a new walk, then whatever the last call returned.
+ * @param count Roughly how many entries to visit before returning.
+ * @param fn Called on each entry, see scan_function.
+ * @param arg Passed on to <fn> as is.
+ * @return The cursor for the next call, 0 once the walk is done.
+ * @note Like Redis's SCAN: entries that are in the table from the first call
+ * to the last are visited at least once, even if the table grows meanwhile.
+ * Some may be visited more than once, and ones added or deleted during the
+ * walk may or may not be.
+ * @note The cursor is just a number, so it's fine to insert, delete or
+ * hand it to another thread between calls.
+  */
+uint64_t ht_scan(table *ht, uint64_t cursor, size_t count, scan_function *fn,
+                 void *arg);
+
+/**
+ * @brief Write every key and serialized obj of <ht> to a file at <path>.
+ * @param ht Pointer to the hashtable to save, any backend.
+ * @param path Where to write the file, replaced if it already exists.
+ * @param sf Called on every obj, see serialize_function.
+ * @return true if successful, false otherwise.
+ * @note The file has no pointers in it, ht_open_mmap can use it as is.
+ * @note Written to <path>.tmp, synced to disk, then renamed over <path>.
+ * A crash or power loss leaves the old file or the new one, never half.
+ * @note Nothing may write to <ht> meanwhile, not even on HT_CONCURRENT tables.
+  */
+bool ht_save(table *ht, const char *path, serialize_function *sf);
+
+/**
+ * @brief Map a file written by ht_save and look keys up straight in it.
+ * @param path The file ht_save wrote, on this same kind of machine.
+ * @return A read-only table on success, NULL otherwise.
+ * @note Nothing is read or copied up front. Each ht_find only touches the
+ * pages its key lives in, so opening is instant however big the file is.
+ * @note ht_find returns the address of the obj's serialized bytes inside
+ * the file. It's read-only, and valid until ht_destroy.
+ * @note Inserting, deleting or replacing anything fails. ht_destroy unmaps
+ * the file and never calls a cleanup function.
+  */
+table *ht_open_mmap(const char *path);
+
+/**
+ * @brief Keep objects found by this thread alive until ht_unpin.
+ * @param ht Pointer to a HT_CONCURRENT hashtable, others are ignored.
+ * @note ht_find on its own only protects the linked list walk. If another
+ * thread may ht_delete an object you're still using, wrap both in these.
+ * @note Nothing deleted meanwhile can be freed while you're pinned, so
+ * don't stay pinned for long.
+  */
+void ht_pin(table *ht);
+void ht_unpin(table *ht);
+
 #endif // GENERIC_HASHTABLE_H
\ No newline at end of file
@@ -0,0 +1,189 @@
+/**
+ * @file genhashtable_batch.c
+ * @brief Batched lookups and inserts with software prefetching.
+ *
+ * A lone ht_find waits on 1 cache miss for the bucket, then 1 for each node
+ * and 1 for each key it compares. Given many keys at once, we can hash a
+ * group of them, ask for all their buckets, then all their first nodes,
+ * then all their keys, so those misses overlap instead of adding up.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "genhashtable_internal.h"
+
+// # of keys in flight at once. Enough to hide memory latency, but not so
+// many that the first prefetches get evicted before we use them.
+#define BATCH_GROUP 16
+
+/**
+ * @brief Resolve up to BATCH_GROUP keys of a chained table in stages.
+ * @note Only for tables that aren't mid-resize, so 1 array is enough.
+ */
+static void chain_find_group(table *ht, const char **keys, void **out,
+                             const size_t *lengths, const uint64_t *hashes,
+                             size_t count)
+{
+    sllnode *nodes[BATCH_GROUP];
+
+    // Stage 1: ask for every bucket head.
+    for (size_t i = 0; i < count; i++)
+        __builtin_prefetch(&ht->elements[ht_bucket(hashes[i], ht->size)]);
+
+    // Stage 2: read the heads, ask for every first node.
+    for (size_t i = 0; i < count; i++)
+    {
+        nodes[i] = ht->elements[ht_bucket(hashes[i], ht->size)];
+        if (nodes[i] != NULL) __builtin_prefetch(nodes[i]);
+    }
+
+    // Stage 3: ask for the key bytes of every first node that may match.
+    for (size_t i = 0; i < count; i++)
+    {
+        if (nodes[i] != NULL && nodes[i]->hash == hashes[i])
+            __builtin_prefetch(nodes[i]->key);
+    }
+
+    // Stage 4: the usual walk, the first steps should all be cached now.
+    for (size_t i = 0; i < count; i++)
+    {
+        uint64_t probes = 0, compares = 0;
+        sllnode *tmp = nodes[i];
+        while (tmp != NULL)
+        {
+            probes++;
+            if (tmp->hash == hashes[i] && tmp->length == lengths[i])
+            {
+                compares++;
+                if (memcmp(tmp->key, keys[i], lengths[i]) == 0) break;
+            }
+            tmp = tmp->next;
+        }
+        ht_count_lookup(ht, probes, compares);
+        out[i] = (tmp != NULL) ? tmp->obj : NULL;
+    }
+}
+
+/**
+ * @brief Hash the next group of keys and prefetch where each one lives.
+ * @note Chained tables mid-resize don't get prefetched, they're short-lived.
+ */
+static void hash_group(table *ht, const char **keys, size_t *lengths,
+                       uint64_t *hashes, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        lengths[i] = strlen(keys[i]);
+        hashes[i] = ht_hash(ht, keys[i], lengths[i]);
+
+        if (ht->flags & HT_BLOOM)
+            bloom_prefetch(ht, hashes[i]);
+        else if (ht->flags & HT_OPEN_ADDRESSING)
+            oa_prefetch(ht, hashes[i]);
+        else if (ht->flags & HT_MAPPED)
+            map_prefetch(ht, hashes[i]);
+        else if (!ht_rehashing(ht))
+            __builtin_prefetch(&ht->elements[ht_bucket(hashes[i], ht->size)]);
+    }
+}
+
+size_t ht_find_batch(table *ht, const char **keys, size_t n, void **out)
+{
+    if (ht == NULL || keys == NULL || out == NULL) return 0;
+
+    size_t found = 0;
+    size_t lengths[BATCH_GROUP];
+    uint64_t hashes[BATCH_GROUP];
+    for (size_t base = 0; base < n; base += BATCH_GROUP)
+    {
+        size_t count = (n - base < BATCH_GROUP) ? n - base : BATCH_GROUP;
+        const char **group_keys = &keys[base];
+        void **group_out = &out[base];
+
+        // chain_find_group does its own prefetching, in stages. Cache
+        // tables take the slow path, every hit has to be counted and touched.
+        // So do Bloom filtered ones, most misses never touch a chain.
+        if (!(ht->flags & (HT_OPEN_ADDRESSING | HT_CONCURRENT | HT_MAPPED
+                           | HT_CACHE | HT_BLOOM))
+            && !ht_rehashing(ht))
+        {
+            for (size_t i = 0; i < count; i++)
+            {
+                lengths[i] = strlen(group_keys[i]);
+                hashes[i] = ht_hash(ht, group_keys[i], lengths[i]);
+            }
+            chain_find_group(ht, group_keys, group_out, lengths, hashes, count);
+        }
+        else
+        {
+            hash_group(ht, group_keys, lengths, hashes, count);
+            for (size_t i = 0; i < count; i++)
+            {
+                if (ht->flags & HT_CONCURRENT)
+                {
+                    group_out[i] = cc_find(ht, group_keys[i], lengths[i], hashes[i]);
+                    continue;
+                }
+                if (ht->flags & HT_MAPPED)
+                {
+                    group_out[i] = map_find(ht, group_keys[i], lengths[i], hashes[i]);
+                    continue;
+                }
+                void **slot = ht_probe_hashed(ht, group_keys[i], lengths[i],
+                                              hashes[i], false, NULL);
+                group_out[i] = (slot != NULL) ? *slot : NULL;
+                if (ht->flags & HT_CACHE)
+                {
+                    if (slot != NULL) ht->cache.hits++;
+                    else ht->cache.misses++;
+                }
+            }
+        }
+
+        for (size_t i = 0; i < count; i++)
+        {
+            if (group_out[i] != NULL) found++;
+        }
+    }
+    return found;
+}
+
+size_t ht_insert_batch(table *ht, const char **keys, void **objs, size_t n,
+                       bool *inserted)
+{
+    if (ht == NULL || keys == NULL || objs == NULL) return 0;
+
+    size_t added = 0;
+    size_t lengths[BATCH_GROUP];
+    uint64_t hashes[BATCH_GROUP];
+    for (size_t base = 0; base < n; base += BATCH_GROUP)
+    {
+        size_t count = (n - base < BATCH_GROUP) ? n - base : BATCH_GROUP;
+        hash_group(ht, &keys[base], lengths, hashes, count);
+
+        for (size_t i = 0; i < count; i++)
+        {
+            size_t k = base + i;
+            // Same as ht_insert, NULL objects aren't allowed.
+            bool ok = false;
+            if (objs[k] != NULL && (ht->flags & HT_CONCURRENT))
+            {
+                ok = cc_insert(ht, keys[k], lengths[i], hashes[i], objs[k]);
+            }
+            else if (objs[k] != NULL)
+            {
+                // An insert may start a resize, ht_probe_hashed copes with it.
+                void **slot = ht_probe_hashed(ht, keys[k], lengths[i],
+                                              hashes[i], true, &ok);
+                if (slot != NULL && ok) ht_store(ht, slot, objs[k]);
+            }
+
+            if (ok) added++;
+            if (inserted != NULL) inserted[k] = ok;
+        }
+    }
+    return added;
+}
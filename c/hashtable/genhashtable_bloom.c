@@ -0,0 +1,273 @@
+/**
+ * @file genhashtable_bloom.c
+ * @brief HT_BLOOM tables: a blocked Bloom filter in front of every lookup.
+ *
+ * Each key sets 8 bits, all inside 1 block of 64 bytes: 1 bit in each of
+ * the block's 8 words. Which block comes from the key's hash, and which
+ * bit of each word from that hash times a different odd constant per word.
+ * So a miss costs 1 cache line and no chain walk, most of the time.
+ * This is the "split block" layout of Apache Parquet and Impala.
+ *
+ * Bits can't be taken back out. Deleted keys are only counted, and once
+ * enough of them pile up a new filter is filled from the entries still in
+ * the table. The same happens when the table outgrows the filter. That
+ * fill walks a few buckets per insert/find/delete, the same way a resize
+ * moves them. The old filter keeps answering, and getting new keys, until
+ * the new one has everything.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "genhashtable_internal.h"
+
+#define BLOOM_WORDS 8
+#define BLOOM_BLOCK_BYTES (BLOOM_WORDS * sizeof(uint64_t))
+
+// 16 bits per key, about 1 false positive per 200 misses at full load.
+#define BLOOM_KEYS_PER_BLOCK 32
+
+// # of used buckets (or slots) put in the new filter by each call.
+#define BLOOM_FILL_STEP 8
+
+static const uint32_t bloom_salt[BLOOM_WORDS] = {
+    0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+    0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U,
+};
+
+// Spread the hash again, buckets already used its low bits.
+static inline uint64_t bloom_mix(uint64_t hash)
+{
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+static inline uint64_t *bloom_block(struct bloom_filter *filter,
+                                    uint64_t mixed)
+{
+    return &filter->blocks[(mixed & (filter->nblocks - 1)) * BLOOM_WORDS];
+}
+
+// Bit <i> of the block's 8 words, 6 bits of (upper hash * salt) each.
+static inline uint64_t bloom_bit(uint64_t mixed, int i)
+{
+    uint32_t upper = (uint32_t)(mixed >> 32);
+    return 1ULL << ((upper * bloom_salt[i]) >> 26);
+}
+
+static void bloom_set(struct bloom_filter *filter, uint64_t hash)
+{
+    uint64_t mixed = bloom_mix(hash);
+    uint64_t *block = bloom_block(filter, mixed);
+    for (int i = 0; i < BLOOM_WORDS; i++) block[i] |= bloom_bit(mixed, i);
+}
+
+static bool bloom_test(struct bloom_filter *filter, uint64_t hash)
+{
+    uint64_t mixed = bloom_mix(hash);
+    const uint64_t *block = bloom_block(filter, mixed);
+    for (int i = 0; i < BLOOM_WORDS; i++)
+    {
+        if (!(block[i] & bloom_bit(mixed, i))) return false;
+    }
+    return true;
+}
+
+static void bloom_free(struct bloom_filter *filter)
+{
+    free(filter->raw);
+    memset(filter, 0, sizeof(*filter));
+}
+
+
+void bloom_destroy(table *ht)
+{
+    bloom_free(&ht->bloom.now);
+    bloom_free(&ht->bloom.next);
+}
+
+// Smallest filter with room for twice the entries we have now.
+static size_t bloom_nblocks(table *ht)
+{
+    size_t nblocks = 1;
+    while (nblocks * BLOOM_KEYS_PER_BLOCK < ht->count * 2) nblocks *= 2;
+    return nblocks;
+}
+
+/**
+ * @brief Throw away any fill in progress and start a new one from scratch.
+ * @note calloc rather than aligned_alloc + memset: big ones come straight
+ * from the OS already zeroed, so the pages get touched as the fill goes.
+ * Out of memory, we keep what we have and try again on a later call.
+ */
+static void bloom_start(table *ht)
+{
+    struct ht_bloom *bloom = &ht->bloom;
+    bloom_free(&bloom->next);
+
+    size_t nblocks = bloom_nblocks(ht);
+    void *raw = calloc(1, nblocks * BLOOM_BLOCK_BYTES + BLOOM_BLOCK_BYTES);
+    if (raw == NULL) return;
+    ht_count(ht, &ht->counters.allocations, 1);
+
+    uintptr_t aligned = ((uintptr_t)raw + BLOOM_BLOCK_BYTES - 1)
+                        & ~(uintptr_t)(BLOOM_BLOCK_BYTES - 1);
+    bloom->next.blocks = (uint64_t *)aligned;
+    bloom->next.nblocks = nblocks;
+    bloom->next.raw = raw;
+    bloom->fill_idx = 0;
+}
+
+// Every entry is in <next> now, so it takes over from <now>.
+static void bloom_finish(struct ht_bloom *bloom)
+{
+    bloom_free(&bloom->now);
+    bloom->now = bloom->next;
+    memset(&bloom->next, 0, sizeof(bloom->next));
+    bloom->fill_idx = 0;
+}
+
+/**
+ * @brief Put up to <budget> used buckets (or slots) into the new filter.
+ * @note Chained tables mid-resize have the new array's buckets first, then
+ * the old one's. Nodes moved from an old bucket we haven't reached into a
+ * new one we're past are caught by bloom_moved.
+ */
+static void bloom_fill(table *ht, size_t budget)
+{
+    struct ht_bloom *bloom = &ht->bloom;
+    size_t size = (size_t)ht->size;
+    size_t end = size + (ht_rehashing(ht) ? (size_t)ht->old_size : 0);
+
+    // Don't let a long run of empty buckets make this call slow either.
+    size_t empty_visits = budget * 10;
+    while (budget > 0 && bloom->fill_idx < end)
+    {
+        size_t i = bloom->fill_idx++;
+        bool used;
+        if (ht->flags & HT_OPEN_ADDRESSING)
+        {
+            used = !(ht->ctrl[i] & 0x80);
+            if (used) bloom_set(&bloom->next, ht->slots[i].hash);
+        }
+        else
+        {
+            sllnode *tmp = (i < size) ? ht->elements[i]
+                                      : ht->old_elements[i - size];
+            used = tmp != NULL;
+            for (; tmp != NULL; tmp = tmp->next)
+                bloom_set(&bloom->next, tmp->hash);
+        }
+
+        if (used) budget--;
+        else if (--empty_visits == 0) break;
+    }
+    if (bloom->fill_idx >= end) bloom_finish(bloom);
+}
+
+/**
+ * @brief Called by every insert/find/delete: fill a little of the new
+ * filter, or start one if the current one is too full or too stale.
+ */
+static void bloom_tick(table *ht)
+{
+    struct ht_bloom *bloom = &ht->bloom;
+    if (bloom->next.blocks != NULL)
+    {
+        // Outgrew even the new one before it was done? Start over bigger.
+        if (ht->count > bloom->next.nblocks * BLOOM_KEYS_PER_BLOCK)
+            bloom_start(ht);
+        else
+            bloom_fill(ht, BLOOM_FILL_STEP);
+        return;
+    }
+
+    if (bloom->now.blocks == NULL
+        || ht->count > bloom->now.nblocks * BLOOM_KEYS_PER_BLOCK
+        || bloom->now.deleted > ht->count / 4 + BLOOM_KEYS_PER_BLOCK)
+        bloom_start(ht);
+}
+
+void bloom_init(table *ht)
+{
+    memset(&ht->bloom, 0, sizeof(ht->bloom));
+
+    // An empty filter for an empty table is complete already.
+    if ((ht->flags & HT_BLOOM) && ht->count == 0)
+    {
+        bloom_start(ht);
+        if (ht->bloom.next.blocks != NULL) bloom_finish(&ht->bloom);
+    }
+}
+
+void bloom_rebuild(table *ht)
+{
+    bloom_start(ht);
+    while (ht->bloom.next.blocks != NULL)
+        bloom_fill(ht, SIZE_MAX / 16);
+}
+
+void bloom_resize(table *ht)
+{
+    // Positions in the old layout mean nothing now, so a fill restarts too.
+    bloom_start(ht);
+}
+
+void bloom_moved(table *ht, uint64_t hash)
+{
+    if (ht->bloom.next.blocks != NULL) bloom_set(&ht->bloom.next, hash);
+}
+
+bool bloom_maybe(table *ht, uint64_t hash)
+{
+    struct ht_bloom *bloom = &ht->bloom;
+    bloom_tick(ht);
+
+    // <now> gets every new key even while <next> is filling, so it's all we
+    // need to ask. <next> may be thrown away half done, see bloom_start.
+    if (bloom->now.blocks == NULL || bloom_test(&bloom->now, hash))
+        return true;
+
+    bloom->negatives++;
+    return false;
+}
+
+void bloom_add(table *ht, uint64_t hash)
+{
+    struct ht_bloom *bloom = &ht->bloom;
+    bloom_tick(ht);
+
+    // The fill may be past <hash>'s bucket already, so set it in both.
+    if (bloom->next.blocks != NULL) bloom_set(&bloom->next, hash);
+    if (bloom->now.blocks != NULL) bloom_set(&bloom->now, hash);
+}
+
+void bloom_forget(table *ht)
+{
+    ht->bloom.now.deleted++;
+    ht->bloom.next.deleted++;
+    bloom_tick(ht);
+}
+
+void bloom_prefetch(table *ht, uint64_t hash)
+{
+    if (ht->bloom.now.blocks != NULL)
+        __builtin_prefetch(bloom_block(&ht->bloom.now, bloom_mix(hash)));
+}
+
+void bloom_stats(table *ht, struct ht_stats *stats)
+{
+    struct ht_bloom *bloom = &ht->bloom;
+    stats->bytes += (bloom->now.nblocks + bloom->next.nblocks)
+                    * BLOOM_BLOCK_BYTES;
+    stats->filtered = bloom->negatives;
+    stats->false_positives = bloom->false_positives;
+
+    uint64_t misses = bloom->negatives + bloom->false_positives;
+    stats->false_positive_rate = (misses != 0)
+        ? (double)bloom->false_positives / (double)misses : 0.0;
+}
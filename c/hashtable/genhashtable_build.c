@@ -0,0 +1,358 @@
+/**
+ * @file genhashtable_build.c
+ * @brief ht_build_parallel, filling a new chained table from many threads.
+ *
+ * 3 rounds of threads, with nothing shared that needs a lock:
+ * 1. Each thread hashes its own slice of the input and counts how many
+ *    entries fall in each partition, a contiguous range of buckets.
+ * 2. Each thread copies its slice's indexes into <order>, grouped by
+ *    partition. Every thread knows exactly where its part goes.
+ * 3. Threads claim whole partitions and link their entries. No 2 threads
+ *    ever touch the same bucket, so the linked lists need no locks.
+ * Input order is kept within a partition, so duplicates resolve the same
+ * way repeated ht_insert calls would: the first one wins.
+ */
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "genhashtable_internal.h"
+
+// Partitions per thread, more means better balance but more counting.
+#define BUILD_PARTITIONS_PER_THREAD 8
+#define BUILD_MAX_THREADS 256
+
+// Everything the threads of ht_build_parallel share, read-only mostly.
+struct build_shared
+{
+    table *ht;
+    const char **keys;
+    void **objs;
+    size_t n;
+    bool unique;
+    bool *inserted;
+
+    int nthreads;
+    size_t npartitions;
+    int shift;                      // bucket >> shift = partition.
+    uint64_t *hashes;
+    size_t *lengths;
+    size_t *counts;                 // [thread][partition], then offsets.
+    size_t *order;                  // Input indexes, grouped by partition.
+    size_t *partition_start;        // Where each partition begins in <order>.
+    size_t next_partition;          // Claimed atomically in round 3.
+
+    // HT_POOLED only: room for every node and key, carved out up front.
+    char *nodes;                    // pool.node_size bytes per node.
+    char *key_bytes;
+    size_t *key_offsets;            // Per input index, into <key_bytes>.
+};
+
+// What each thread is told, plus what it reports back.
+struct build_thread
+{
+    struct build_shared *shared;
+    int id;
+    size_t linked;
+    size_t collisions;
+    size_t allocations;
+    bool failed;
+};
+
+static inline size_t build_partition(struct build_shared *s, uint64_t hash)
+{
+    return ht_bucket(hash, s->ht->size) >> s->shift;
+}
+
+// Thread <id>'s slice of the input is [start, end).
+static void build_slice(struct build_shared *s, int id, size_t *start,
+                        size_t *end)
+{
+    *start = s->n * (size_t)id / (size_t)s->nthreads;
+    *end = s->n * (size_t)(id + 1) / (size_t)s->nthreads;
+}
+
+// Round 1: hash our slice and count entries per partition.
+static void *build_hash(void *arg)
+{
+    struct build_thread *t = arg;
+    struct build_shared *s = t->shared;
+    size_t *counts = &s->counts[(size_t)t->id * s->npartitions];
+
+    size_t start, end;
+    build_slice(s, t->id, &start, &end);
+    for (size_t i = start; i < end; i++)
+    {
+        s->lengths[i] = strlen(s->keys[i]);
+        s->hashes[i] = ht_hash(s->ht, s->keys[i], s->lengths[i]);
+        counts[build_partition(s, s->hashes[i])]++;
+    }
+    return NULL;
+}
+
+// Round 2: <counts> are offsets into <order> now, scatter our slice there.
+static void *build_scatter(void *arg)
+{
+    struct build_thread *t = arg;
+    struct build_shared *s = t->shared;
+    size_t *offsets = &s->counts[(size_t)t->id * s->npartitions];
+
+    size_t start, end;
+    build_slice(s, t->id, &start, &end);
+    for (size_t i = start; i < end; i++)
+        s->order[offsets[build_partition(s, s->hashes[i])]++] = i;
+    return NULL;
+}
+
+/**
+ * @brief Make the node for input <i>, with its own copy of the key.
+ * @note Pooled tables had room for it set aside before any thread started.
+ */
+static sllnode *build_node(struct build_thread *t, size_t i)
+{
+    struct build_shared *s = t->shared;
+    size_t length = s->lengths[i];
+    sllnode *node;
+    char *key;
+    if (s->nodes != NULL)
+    {
+        // The pool decides how big a node is, not sizeof(sllnode).
+        node = (sllnode *)(s->nodes + i * s->ht->pool.node_size);
+        key = s->key_bytes + s->key_offsets[i];
+    }
+    else
+    {
+        node = malloc(ht_node_bytes(s->ht) + s->ht->value_size);
+        key = malloc(length + 1);
+        if (node == NULL || key == NULL)
+        {
+            free(node);
+            free(key);
+            return NULL;
+        }
+        t->allocations += 2;
+    }
+
+    memcpy(key, s->keys[i], length);
+    key[length] = '\0';
+    node->key = key;
+    node->obj = s->objs[i];
+    node->hash = s->hashes[i];
+    node->length = length;
+    return node;
+}
+
+// Is input <i> already in <head>'s linked list?
+static bool build_exists(struct build_shared *s, sllnode *head, size_t i)
+{
+    for (sllnode *tmp = head; tmp != NULL; tmp = tmp->next)
+    {
+        if (tmp->hash == s->hashes[i] && tmp->length == s->lengths[i]
+            && memcmp(tmp->key, s->keys[i], s->lengths[i]) == 0)
+            return true;
+    }
+    return false;
+}
+
+// Round 3: claim partitions until there are none left, link their entries.
+static void *build_link(void *arg)
+{
+    struct build_thread *t = arg;
+    struct build_shared *s = t->shared;
+    table *ht = s->ht;
+
+    // Tallied locally, <threads> sit next to each other in memory.
+    size_t linked = 0, collisions = 0;
+    for (;;)
+    {
+        size_t p = __atomic_fetch_add(&s->next_partition, 1, __ATOMIC_RELAXED);
+        if (p >= s->npartitions) break;
+
+        for (size_t k = s->partition_start[p]; k < s->partition_start[p + 1]; k++)
+        {
+            size_t i = s->order[k];
+            size_t idx = ht_bucket(s->hashes[i], ht->size);
+            bool ok = !t->failed && s->objs[i] != NULL
+                      && (s->unique || !build_exists(s, ht->elements[idx], i));
+
+            sllnode *node = ok ? build_node(t, i) : NULL;
+            if (ok && node == NULL) t->failed = true;
+            if (node != NULL)
+            {
+                if (ht->elements[idx] != NULL) collisions++;
+                node->next = ht->elements[idx];
+                ht->elements[idx] = node;
+                linked++;
+            }
+            if (s->inserted != NULL) s->inserted[i] = node != NULL;
+        }
+    }
+    t->linked = linked;
+    t->collisions = collisions;
+    return NULL;
+}
+
+/**
+ * @brief Run <fn> on <nthreads> threads and wait for all of them.
+ * @note If a thread can't be started, its share runs on this one instead.
+ */
+static void build_round(struct build_thread *threads, int nthreads,
+                        void *(*fn)(void *))
+{
+    pthread_t ids[nthreads];
+    bool started[nthreads];
+    for (int t = 1; t < nthreads; t++)
+        started[t] = pthread_create(&ids[t], NULL, fn, &threads[t]) == 0;
+
+    fn(&threads[0]);
+    for (int t = 1; t < nthreads; t++)
+    {
+        if (started[t])
+            pthread_join(ids[t], NULL);
+        else
+            fn(&threads[t]);
+    }
+}
+
+/**
+ * @brief HT_POOLED tables: 1 slab for every node, 1 chunk for every key.
+ * @note Single threaded, but it's just a prefix sum over the lengths.
+ */
+static bool build_reserve(struct build_shared *s)
+{
+    size_t key_total = 0;
+    for (size_t i = 0; i < s->n; i++)
+    {
+        s->key_offsets[i] = key_total;
+        key_total += s->lengths[i] + 1;
+    }
+    s->nodes = pool_node_bulk(&s->ht->pool, s->n);
+    s->key_bytes = pool_key_alloc(&s->ht->pool, key_total + 1);
+    return s->nodes != NULL && s->key_bytes != NULL;
+}
+
+// On failure the caller keeps every obj, so ht_destroy mustn't touch them.
+static void build_noclean(void *obj)
+{
+    (void)obj;
+}
+
+/**
+ * @brief Split the input into partitions, then link every entry.
+ * @return false if we ran out of memory somewhere along the way.
+ */
+static bool build_chained(struct build_shared *s, struct build_thread *threads)
+{
+    int nthreads = s->nthreads;
+    build_round(threads, nthreads, build_hash);
+
+    // Turn per-thread counts into offsets: partition by partition, and
+    // within each partition thread by thread, which keeps input order.
+    size_t offset = 0;
+    for (size_t p = 0; p < s->npartitions; p++)
+    {
+        s->partition_start[p] = offset;
+        for (int t = 0; t < nthreads; t++)
+        {
+            size_t *count = &s->counts[(size_t)t * s->npartitions + p];
+            size_t here = *count;
+            *count = offset;
+            offset += here;
+        }
+    }
+    s->partition_start[s->npartitions] = offset;
+    build_round(threads, nthreads, build_scatter);
+
+    if ((s->ht->flags & HT_POOLED) && !build_reserve(s)) return false;
+    build_round(threads, nthreads, build_link);
+
+    bool ok = true;
+    for (int t = 0; t < nthreads; t++)
+    {
+        s->ht->count += threads[t].linked;
+        s->ht->collisions += threads[t].collisions;
+        ht_count(s->ht, &s->ht->counters.allocations, threads[t].allocations);
+        if (threads[t].failed) ok = false;
+    }
+    return ok;
+}
+
+table *ht_build_parallel(const char **keys, void **objs, size_t n,
+                         int nthreads, hash_function *hf, cleanup_function *cf,
+                         unsigned flags, bool *inserted)
+{
+    if ((keys == NULL || objs == NULL) && n != 0) return NULL;
+    if (n > INT32_MAX)
+    {
+        printf("Too many entries for 1 hashtable!\n");
+        return NULL;
+    }
+
+    bool unique = (flags & HT_UNIQUE_KEYS) != 0;
+    table *ht = ht_create((int)n, hf, cf, flags & ~HT_UNIQUE_KEYS);
+    if (ht == NULL) return NULL;
+
+    // Open addressing probes across groups, so buckets can't be split up.
+    // Cache tables evict as they go, which needs 1 thread doing it in order.
+    if (n == 0 || (flags & (HT_OPEN_ADDRESSING | HT_CACHE)))
+    {
+        ht_insert_batch(ht, keys, objs, n, inserted);
+        return ht;
+    }
+
+    if (nthreads < 1) nthreads = 1;
+    if (nthreads > BUILD_MAX_THREADS) nthreads = BUILD_MAX_THREADS;
+    struct build_shared s = {
+        .ht = ht, .keys = keys, .objs = objs, .n = n, .unique = unique,
+        .inserted = inserted, .nthreads = nthreads,
+    };
+
+    // Partitions are a power of 2 and at most 1 bucket each.
+    int size_bits = __builtin_ctz((unsigned)ht->size);
+    int partition_bits = 0;
+    while ((1 << partition_bits) < nthreads * BUILD_PARTITIONS_PER_THREAD
+           && partition_bits < size_bits)
+        partition_bits++;
+    s.npartitions = (size_t)1 << partition_bits;
+    s.shift = size_bits - partition_bits;
+
+    s.hashes = malloc((n + 1) * sizeof(uint64_t));
+    s.lengths = malloc((n + 1) * sizeof(size_t));
+    s.order = malloc((n + 1) * sizeof(size_t));
+    s.counts = calloc((size_t)nthreads * s.npartitions, sizeof(size_t));
+    s.partition_start = malloc((s.npartitions + 1) * sizeof(size_t));
+    if (ht->flags & HT_POOLED) s.key_offsets = malloc((n + 1) * sizeof(size_t));
+    struct build_thread *threads = calloc((size_t)nthreads, sizeof(*threads));
+
+    bool ok = s.hashes != NULL && s.lengths != NULL && s.order != NULL
+              && s.counts != NULL && s.partition_start != NULL
+              && threads != NULL
+              && (!(ht->flags & HT_POOLED) || s.key_offsets != NULL);
+    if (ok)
+    {
+        for (int t = 0; t < nthreads; t++)
+            threads[t] = (struct build_thread){.shared = &s, .id = t};
+        ok = build_chained(&s, threads);
+    }
+    if (ok && (ht->flags & HT_BLOOM)) bloom_rebuild(ht);
+
+    free(s.hashes);
+    free(s.lengths);
+    free(s.order);
+    free(s.counts);
+    free(s.partition_start);
+    free(s.key_offsets);
+    free(threads);
+    if (!ok)
+    {
+        printf("Failed to allocate memory to build hashtable!\n");
+        ht->clean_fn = build_noclean;
+        ht_destroy(ht);
+        return NULL;
+    }
+    return ht;
+}
@@ -0,0 +1,186 @@
+/**
+ * @file genhashtable_cache.c
+ * @brief HT_CACHE tables: a budget on entries or bytes, and who to evict.
+ *
+ * Every entry of a cache table is also on 1 doubly-linked list, the queue,
+ * newest first. Its links live right after its node, so neither a hit nor
+ * an eviction ever allocates.
+ * - HT_EVICT_LRU moves an entry to the front on every hit, and evicts from
+ *   the back.
+ * - HT_EVICT_SIEVE only sets <visited> on a hit. A hand walks from the
+ *   oldest entry towards the newest, clearing <visited> as it goes, and
+ *   evicts the first entry it finds already cleared. Entries never move,
+ *   so a hit is 1 store, or none at all if the bit was set already.
+ * See "SIEVE is Simpler than LRU", Zhang et al., NSDI '24.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "genhashtable_internal.h"
+
+void cache_init(table *ht)
+{
+    memset(&ht->cache, 0, sizeof(ht->cache));
+    ht->cache.policy = HT_EVICT_SIEVE;
+}
+
+static void queue_unlink(struct ht_cache *cache, sllnode *node)
+{
+    struct ht_cache_links *links = ht_links(node);
+    if (links->newer != NULL)
+        ht_links(links->newer)->older = links->older;
+    else
+        cache->newest = links->older;
+
+    if (links->older != NULL)
+        ht_links(links->older)->newer = links->newer;
+    else
+        cache->oldest = links->newer;
+}
+
+static void queue_push(struct ht_cache *cache, sllnode *node)
+{
+    struct ht_cache_links *links = ht_links(node);
+    links->newer = NULL;
+    links->older = cache->newest;
+    if (cache->newest != NULL)
+        ht_links(cache->newest)->newer = node;
+    else
+        cache->oldest = node;
+    cache->newest = node;
+}
+
+// What <node> costs: its node, key and inline value, plus the obj's weight.
+static size_t cache_cost(table *ht, sllnode *node)
+{
+    size_t cost = ht_node_bytes(ht) + ht->value_size + node->length + 1;
+    if (ht->cache.cost_fn != NULL && node->obj != NULL)
+        cost += ht->cache.cost_fn(node->obj);
+    return cost;
+}
+
+static bool cache_over(table *ht)
+{
+    struct ht_cache *cache = &ht->cache;
+    return (cache->max_entries != 0 && ht->count > cache->max_entries)
+        || (cache->max_bytes != 0 && cache->bytes > cache->max_bytes);
+}
+
+/**
+ * @brief Pick the next entry to evict.
+ * @return Any entry but <keep>, NULL if <keep> is all there is.
+ */
+static sllnode *cache_victim(table *ht, sllnode *keep)
+{
+    struct ht_cache *cache = &ht->cache;
+    sllnode *node = cache->oldest;
+    if (node == NULL) return NULL;
+    if (cache->policy == HT_EVICT_LRU)
+        return (node != keep) ? node : ht_links(node)->newer;
+    if (node == keep && cache->newest == keep) return NULL;
+
+    // Every pass clears what it skips, so this ends within 2 of them.
+    if (cache->hand != NULL) node = cache->hand;
+    for (;;)
+    {
+        struct ht_cache_links *links = ht_links(node);
+        sllnode *next = (links->newer != NULL) ? links->newer : cache->oldest;
+        if (node != keep && !links->visited)
+        {
+            // Carry on from here next time, like the hand of a clock.
+            cache->hand = links->newer;
+            return node;
+        }
+        links->visited = false;
+        node = next;
+    }
+}
+
+// Evict until we're within budget again, or only <keep> is left.
+static void cache_evict(table *ht, sllnode *keep)
+{
+    while (cache_over(ht))
+    {
+        sllnode *victim = cache_victim(ht, keep);
+        if (victim == NULL) return;
+
+        ht_evict(ht, victim);
+        ht->cache.evictions++;
+    }
+}
+
+void cache_admit(table *ht, sllnode *node)
+{
+    struct ht_cache_links *links = ht_links(node);
+    links->visited = false;
+    links->cost = cache_cost(ht, node);
+    ht->cache.bytes += links->cost;
+    queue_push(&ht->cache, node);
+    cache_evict(ht, node);
+}
+
+void cache_charge(table *ht, sllnode *node)
+{
+    struct ht_cache_links *links = ht_links(node);
+    ht->cache.bytes -= links->cost;
+    links->cost = cache_cost(ht, node);
+    ht->cache.bytes += links->cost;
+    cache_evict(ht, node);
+}
+
+void cache_touch(table *ht, sllnode *node)
+{
+    struct ht_cache *cache = &ht->cache;
+    if (cache->policy == HT_EVICT_LRU)
+    {
+        if (cache->newest == node) return;
+        if (cache->hand == node) cache->hand = ht_links(node)->newer;
+        queue_unlink(cache, node);
+        queue_push(cache, node);
+        return;
+    }
+
+    // Don't dirty the cache line if it's marked already.
+    struct ht_cache_links *links = ht_links(node);
+    if (!links->visited) links->visited = true;
+}
+
+void cache_forget(table *ht, sllnode *node)
+{
+    struct ht_cache *cache = &ht->cache;
+    if (cache->hand == node) cache->hand = ht_links(node)->newer;
+    queue_unlink(cache, node);
+    cache->bytes -= ht_links(node)->cost;
+}
+
+bool ht_set_cache(table *ht, size_t max_entries, size_t max_bytes,
+                  unsigned policy, cost_function *cost)
+{
+    if (ht == NULL || !(ht->flags & HT_CACHE)) return false;
+    if (policy != HT_EVICT_LRU && policy != HT_EVICT_SIEVE) return false;
+
+    struct ht_cache *cache = &ht->cache;
+    cache->max_entries = max_entries;
+    cache->max_bytes = max_bytes;
+    cache->policy = policy;
+    cache->hand = NULL;
+
+    // Entries already in were weighed with the old cost function, if any.
+    if (cost != cache->cost_fn)
+    {
+        cache->cost_fn = cost;
+        for (sllnode *node = cache->oldest; node != NULL;
+             node = ht_links(node)->newer)
+        {
+            struct ht_cache_links *links = ht_links(node);
+            cache->bytes -= links->cost;
+            links->cost = cache_cost(ht, node);
+            cache->bytes += links->cost;
+        }
+    }
+    cache_evict(ht, NULL);
+    return true;
+}
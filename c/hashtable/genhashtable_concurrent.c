@@ -0,0 +1,460 @@
+/**
+ * @file genhashtable_concurrent.c
+ * @brief Thread-safe mode for chained tables, selected with HT_CONCURRENT.
+ *
+ * Writers lock 1 of a fixed set of mutexes, picked by bucket index, so
+ * writers on different buckets rarely wait on each other.
+ * Readers take no locks at all. Instead they announce the current epoch
+ * in a slot of their own while they walk a linked list. Deleted nodes (and
+ * replaced objects) are retired with the epoch they were unlinked in, and
+ * only handed to clean_fn once the epoch has moved on twice, by which time
+ * no reader can still be looking at them.
+ */
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "genhashtable_internal.h"
+
+#define CC_STRIPES      64      // # of writer locks, a power of 2.
+#define CC_MAX_READERS  128     // Threads past this fall back to locking.
+#define CC_COLLECT_EVERY 64     // Try to free retired nodes this often.
+#define CC_CACHE_LINE   64
+
+// 1 per reader thread, padded so readers don't share cache lines.
+struct cc_reader
+{
+    uint64_t epoch;             // 0 if not reading, else the epoch seen.
+    char pad[CC_CACHE_LINE - sizeof(uint64_t)];
+};
+
+// A node (or just an obj, if <node> is NULL) waiting to be freed.
+struct cc_retired
+{
+    sllnode *node;
+    void *obj;
+    uint64_t epoch;
+};
+
+struct ht_concurrent
+{
+    pthread_mutex_t stripes[CC_STRIPES];
+    struct cc_reader *readers;      // CC_MAX_READERS of them.
+    uint64_t epoch;                 // Global epoch, starts at 1.
+
+    pthread_mutex_t retire_lock;    // Guards everything below.
+    struct cc_retired *retired;
+    size_t nretired;
+    size_t retired_cap;
+};
+
+/*
+ * Reader slots are handed out per thread, process wide, so a thread uses
+ * the same slot index in every concurrent table. A thread's slot is given
+ * back when it exits, through the pthread key's destructor.
+ */
+static uint64_t cc_reader_bits[CC_MAX_READERS / 64];
+static _Thread_local int cc_reader_idx = -1;
+static pthread_key_t cc_reader_key;
+static pthread_once_t cc_reader_once = PTHREAD_ONCE_INIT;
+
+static void cc_release_reader(void *value)
+{
+    int idx = (int)(intptr_t)value - 1;
+    uint64_t bit = (uint64_t)1 << (idx % 64);
+    __atomic_fetch_and(&cc_reader_bits[idx / 64], ~bit, __ATOMIC_RELEASE);
+}
+
+static void cc_make_key(void)
+{
+    pthread_key_create(&cc_reader_key, cc_release_reader);
+}
+
+/**
+ * @brief Get this thread's reader slot index, claiming one if needed.
+ * @return -1 if all CC_MAX_READERS slots are taken.
+ */
+static int cc_reader_slot(void)
+{
+    if (cc_reader_idx != -1) return cc_reader_idx;
+
+    pthread_once(&cc_reader_once, cc_make_key);
+    for (int word = 0; word < CC_MAX_READERS / 64; word++)
+    {
+        uint64_t bits = __atomic_load_n(&cc_reader_bits[word], __ATOMIC_RELAXED);
+        while (~bits != 0)
+        {
+            int bit = __builtin_ctzll(~bits);
+            if (__atomic_compare_exchange_n(&cc_reader_bits[word], &bits,
+                    bits | ((uint64_t)1 << bit), false,
+                    __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+            {
+                cc_reader_idx = word * 64 + bit;
+
+                // Store idx + 1, the destructor doesn't run on NULL values.
+                pthread_setspecific(cc_reader_key,
+                                    (void *)(intptr_t)(cc_reader_idx + 1));
+                return cc_reader_idx;
+            }
+        }
+    }
+    return -1;
+}
+
+static pthread_mutex_t *cc_stripe(table *ht, size_t idx)
+{
+    return &ht->cc->stripes[idx & (CC_STRIPES - 1)];
+}
+
+/**
+ * @brief Announce that this thread is reading the table.
+ * @return false if we already were, so the caller shouldn't unpin.
+ */
+static bool cc_enter(table *ht, int slot)
+{
+    struct cc_reader *reader = &ht->cc->readers[slot];
+    if (__atomic_load_n(&reader->epoch, __ATOMIC_RELAXED) != 0) return false;
+
+    uint64_t epoch = __atomic_load_n(&ht->cc->epoch, __ATOMIC_ACQUIRE);
+
+    // Our announcement must be visible before we load any list pointers,
+    // a seq_cst exchange is a full barrier (and ThreadSanitizer gets it).
+    __atomic_exchange_n(&reader->epoch, epoch, __ATOMIC_SEQ_CST);
+    return true;
+}
+
+static void cc_leave(table *ht, int slot)
+{
+    __atomic_store_n(&ht->cc->readers[slot].epoch, 0, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Move the global epoch on if every reader has caught up with it,
+ * then free whatever was retired 2 or more epochs ago.
+ * @note Call with <retire_lock> held.
+ */
+static void cc_collect(table *ht)
+{
+    struct ht_concurrent *cc = ht->cc;
+    uint64_t epoch = __atomic_load_n(&cc->epoch, __ATOMIC_RELAXED);
+
+    bool caught_up = true;
+    for (int i = 0; i < CC_MAX_READERS; i++)
+    {
+        uint64_t seen = __atomic_load_n(&cc->readers[i].epoch, __ATOMIC_SEQ_CST);
+        if (seen != 0 && seen != epoch)
+        {
+            caught_up = false;
+            break;
+        }
+    }
+    if (caught_up)
+    {
+        epoch++;
+        __atomic_store_n(&cc->epoch, epoch, __ATOMIC_RELEASE);
+    }
+
+    // Keep whatever is still too recent, in order, at the front.
+    size_t kept = 0;
+    for (size_t i = 0; i < cc->nretired; i++)
+    {
+        struct cc_retired *dead = &cc->retired[i];
+        if (dead->epoch + 2 > epoch)
+        {
+            cc->retired[kept++] = *dead;
+            continue;
+        }
+        ht->clean_fn(dead->obj);
+        if (dead->node != NULL)
+        {
+            ht_key_free(ht, dead->node->key);
+            free(dead->node);
+        }
+    }
+    cc->nretired = kept;
+}
+
+/**
+ * @brief Queue <node> and/or <obj> to be freed once no reader can see them.
+ * @note Call after they have been unlinked, the retire epoch is read here.
+ */
+static void cc_retire(table *ht, sllnode *node, void *obj)
+{
+    struct ht_concurrent *cc = ht->cc;
+    pthread_mutex_lock(&cc->retire_lock);
+
+    if (cc->nretired == cc->retired_cap)
+    {
+        size_t cap = (cc->retired_cap == 0) ? CC_COLLECT_EVERY : cc->retired_cap * 2;
+        struct cc_retired *bigger = realloc(cc->retired, cap * sizeof(*bigger));
+        if (bigger == NULL)
+        {
+            // Nowhere to queue it, and readers might still be using it.
+            pthread_mutex_unlock(&cc->retire_lock);
+            printf("Failed to allocate memory to retire a node, leaking it!\n");
+            return;
+        }
+        cc->retired = bigger;
+        cc->retired_cap = cap;
+    }
+
+    struct cc_retired *dead = &cc->retired[cc->nretired++];
+    dead->node = node;
+    dead->obj = obj;
+    dead->epoch = __atomic_load_n(&cc->epoch, __ATOMIC_ACQUIRE);
+
+    if (cc->nretired % CC_COLLECT_EVERY == 0) cc_collect(ht);
+    pthread_mutex_unlock(&cc->retire_lock);
+}
+
+bool cc_init(table *ht)
+{
+    struct ht_concurrent *cc = malloc(sizeof(*cc));
+    if (cc == NULL) return false;
+
+    cc->readers = aligned_alloc(CC_CACHE_LINE, CC_MAX_READERS * sizeof(struct cc_reader));
+    if (cc->readers == NULL)
+    {
+        free(cc);
+        return false;
+    }
+    memset(cc->readers, 0, CC_MAX_READERS * sizeof(struct cc_reader));
+
+    for (int i = 0; i < CC_STRIPES; i++)
+        pthread_mutex_init(&cc->stripes[i], NULL);
+    pthread_mutex_init(&cc->retire_lock, NULL);
+
+    cc->epoch = 1;
+    cc->retired = NULL;
+    cc->nretired = 0;
+    cc->retired_cap = 0;
+    ht->cc = cc;
+    return true;
+}
+
+void cc_destroy(table *ht)
+{
+    struct ht_concurrent *cc = ht->cc;
+
+    // No readers are left by now, so everything retired can go.
+    for (size_t i = 0; i < cc->nretired; i++)
+    {
+        ht->clean_fn(cc->retired[i].obj);
+        if (cc->retired[i].node != NULL)
+        {
+            ht_key_free(ht, cc->retired[i].node->key);
+            free(cc->retired[i].node);
+        }
+    }
+    for (int i = 0; i < CC_STRIPES; i++)
+        pthread_mutex_destroy(&cc->stripes[i]);
+    pthread_mutex_destroy(&cc->retire_lock);
+
+    free(cc->retired);
+    free(cc->readers);
+    free(cc);
+    ht->cc = NULL;
+}
+
+size_t cc_bytes(table *ht)
+{
+    struct ht_concurrent *cc = ht->cc;
+    return sizeof(*cc) + CC_MAX_READERS * sizeof(struct cc_reader)
+           + cc->retired_cap * sizeof(struct cc_retired);
+}
+
+void cc_pin(table *ht)
+{
+    int slot = cc_reader_slot();
+    if (slot != -1) cc_enter(ht, slot);
+}
+
+void cc_unpin(table *ht)
+{
+    int slot = cc_reader_slot();
+    if (slot != -1) cc_leave(ht, slot);
+}
+
+/**
+ * @brief Walk 1 linked list, safe against writers changing it under us.
+ * @return <key>'s node, NULL if not found.
+ */
+static sllnode *cc_walk(table *ht, sllnode **head, const char *key, 
+                        size_t length, uint64_t hash)
+{
+    uint64_t probes = 0, compares = 0;
+    sllnode *tmp = __atomic_load_n(head, __ATOMIC_ACQUIRE);
+    while (tmp != NULL)
+    {
+        probes++;
+        // <hash>, <length> and <key> never change once a node is published.
+        if (tmp->hash == hash && tmp->length == length)
+        {
+            compares++;
+            if (memcmp(tmp->key, key, length) == 0) break;
+        }
+        tmp = __atomic_load_n(&tmp->next, __ATOMIC_ACQUIRE);
+    }
+    ht_count_lookup(ht, probes, compares);
+    return tmp;
+}
+
+void *cc_find(table *ht, const char *key, size_t length, uint64_t hash)
+{
+    size_t idx = ht_bucket(hash, ht->size);
+    int slot = cc_reader_slot();
+
+    // No reader slot left for this thread, so read like a writer would.
+    if (slot == -1)
+    {
+        pthread_mutex_lock(cc_stripe(ht, idx));
+        sllnode *tmp = cc_walk(ht, &ht->elements[idx], key, length, hash);
+        void *obj = (tmp != NULL) ? tmp->obj : NULL;
+        pthread_mutex_unlock(cc_stripe(ht, idx));
+        return obj;
+    }
+
+    bool pinned = cc_enter(ht, slot);
+    sllnode *tmp = cc_walk(ht, &ht->elements[idx], key, length, hash);
+    void *obj = (tmp != NULL) ? __atomic_load_n(&tmp->obj, __ATOMIC_ACQUIRE) : NULL;
+    if (pinned) cc_leave(ht, slot);
+    return obj;
+}
+
+/**
+ * @brief Allocate and fill in a node for <key>, ready to be linked.
+ * @note Done before taking a lock, other writers shouldn't wait on malloc.
+ */
+static sllnode *cc_new_node(table *ht, const char *key, size_t length,
+                            uint64_t hash, void *obj)
+{
+    sllnode *tmp = malloc(sizeof(*tmp));
+    if (tmp == NULL) return NULL;
+    ht_count(ht, &ht->counters.allocations, 1);
+
+    tmp->key = ht_key_copy(ht, key, length);
+    if (tmp->key == NULL)
+    {
+        free(tmp);
+        return NULL;
+    }
+    tmp->obj = obj;
+    tmp->hash = hash;
+    tmp->length = length;
+    return tmp;
+}
+
+/**
+ * @brief Link <tmp> at the head of its list.
+ * @note Call with the stripe lock held.
+ */
+static void cc_link(table *ht, size_t idx, sllnode *tmp)
+{
+    if (ht->elements[idx] != NULL)
+        __atomic_fetch_add(&ht->collisions, 1, __ATOMIC_RELAXED);
+
+    // Readers may see <tmp> as soon as it's linked, so fill it in first.
+    tmp->next = ht->elements[idx];
+    __atomic_store_n(&ht->elements[idx], tmp, __ATOMIC_RELEASE);
+    __atomic_fetch_add(&ht->count, 1, __ATOMIC_RELAXED);
+}
+
+bool cc_insert(table *ht, const char *key, size_t length, uint64_t hash,
+               void *obj)
+{
+    size_t idx = ht_bucket(hash, ht->size);
+    sllnode *tmp = cc_new_node(ht, key, length, hash, obj);
+    if (tmp == NULL) return false;
+
+    pthread_mutex_lock(cc_stripe(ht, idx));
+
+    // Don't reinsert an object with this exact key if it already exists.
+    bool exists = cc_walk(ht, &ht->elements[idx], key, length, hash) != NULL;
+    if (!exists) cc_link(ht, idx, tmp);
+
+    pthread_mutex_unlock(cc_stripe(ht, idx));
+
+    if (exists)
+    {
+        ht_key_free(ht, tmp->key);
+        free(tmp);
+    }
+    return !exists;
+}
+
+bool cc_upsert(table *ht, const char *key, size_t length, uint64_t hash,
+               void *obj, bool replace_only)
+{
+    size_t idx = ht_bucket(hash, ht->size);
+    sllnode *fresh = NULL;
+    if (!replace_only)
+    {
+        fresh = cc_new_node(ht, key, length, hash, obj);
+        if (fresh == NULL) return false;
+    }
+
+    pthread_mutex_lock(cc_stripe(ht, idx));
+
+    void *old = NULL;
+    sllnode *tmp = cc_walk(ht, &ht->elements[idx], key, length, hash);
+    if (tmp != NULL)
+    {
+        old = tmp->obj;
+        __atomic_store_n(&tmp->obj, obj, __ATOMIC_RELEASE);
+    }
+    else if (fresh != NULL)
+    {
+        cc_link(ht, idx, fresh);
+        tmp = fresh;
+        fresh = NULL;
+    }
+    pthread_mutex_unlock(cc_stripe(ht, idx));
+
+    // Didn't need the node we made after all.
+    if (fresh != NULL)
+    {
+        ht_key_free(ht, fresh->key);
+        free(fresh);
+    }
+
+    // Readers may still hold <old>, so it has to wait like a node. No slot
+    // to hand back either: once unlocked, a delete may retire <tmp> too.
+    if (old != NULL && old != obj) cc_retire(ht, NULL, old);
+    return tmp != NULL;
+}
+
+bool cc_delete(table *ht, const char *key, size_t length, uint64_t hash)
+{
+    size_t idx = ht_bucket(hash, ht->size);
+    pthread_mutex_lock(cc_stripe(ht, idx));
+
+    sllnode **link = &ht->elements[idx];
+    sllnode *tmp = *link;
+    while (tmp != NULL)
+    {
+        if (tmp->hash == hash && tmp->length == length
+            && memcmp(tmp->key, key, length) == 0)
+            break;
+        link = &tmp->next;
+        tmp = *link;
+    }
+
+    // Could not find the obj :(
+    if (tmp == NULL)
+    {
+        pthread_mutex_unlock(cc_stripe(ht, idx));
+        return false;
+    }
+
+    // <tmp->next> stays intact, readers standing on <tmp> can move on.
+    __atomic_store_n(link, tmp->next, __ATOMIC_RELEASE);
+    __atomic_fetch_sub(&ht->count, 1, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(cc_stripe(ht, idx));
+
+    cc_retire(ht, tmp, tmp->obj);
+    return true;
+}
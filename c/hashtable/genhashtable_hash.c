@@ -0,0 +1,243 @@
+/**
+ * @file genhashtable_hash.c
+ * @brief Built-in hash functions, so you don't have to write your own.
+ *
+ * ht_hash_wyhash is a port of Wang Yi's wyhash (public domain): a couple of
+ * 64x64 -> 128 bit multiplies per 16 bytes, and every output bit depends on
+ * every input bit. ht_hash_fast uses the SSE4.2 CRC32C instruction instead
+ * when the CPU has it, checked once at startup. ht_hash_seeded is wyhash
+ * with a random seed, so nobody can pick keys that all land in 1 bucket.
+ * @note Keys are read as little-endian words, so the hashes of the same
+ * key differ between little- and big-endian machines.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+// _mm_crc32_u64 is 64 bit only, 32 bit x86 sticks with wyhash.
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define HT_HAVE_CRC32C 1
+#endif
+
+#include "genhashtable.h"
+
+#ifdef __SIZEOF_INT128__
+__extension__ typedef unsigned __int128 uint128;
+#endif
+
+// wyhash's default secret, 4 odd numbers with 32 bits set each.
+static const uint64_t wy_secret[4] = {
+    0x2d358dccaa6c78a5ULL, 0x8bb84b93962eacc9ULL,
+    0x4b33a62ed433d4a3ULL, 0x4d5a2da51de1aa47ULL,
+};
+
+// Seed of ht_hash_seeded, picked at startup unless ht_hash_set_seed says so.
+static uint64_t hash_seed;
+
+// What ht_hash_fast really calls, picked at startup by hash_init.
+static hash_function *fast_impl;
+
+// Full 128 bit product of <*a> and <*b>, low half in <*a>, high in <*b>.
+static inline void wy_mum(uint64_t *a, uint64_t *b)
+{
+#ifdef __SIZEOF_INT128__
+    uint128 r = (uint128)*a * *b;
+    *a = (uint64_t)r;
+    *b = (uint64_t)(r >> 64);
+#else
+    // No 128 bit type (32 bit targets): 4 32x32 -> 64 bit products, added
+    // up by hand. Same result, so hashes match across machines.
+    uint64_t ha = *a >> 32, la = (uint32_t)*a;
+    uint64_t hb = *b >> 32, lb = (uint32_t)*b;
+    uint64_t hh = ha * hb, hl = ha * lb, lh = la * hb, ll = la * lb;
+    uint64_t mid = (ll >> 32) + (uint32_t)hl + (uint32_t)lh;
+    *a = (mid << 32) | (uint32_t)ll;
+    *b = hh + (hl >> 32) + (lh >> 32) + (mid >> 32);
+#endif
+}
+
+static inline uint64_t wy_mix(uint64_t a, uint64_t b)
+{
+    wy_mum(&a, &b);
+    return a ^ b;
+}
+
+// memcpy so unaligned keys are fine, compilers turn it into 1 load.
+static inline uint64_t wy_r8(const unsigned char *p)
+{
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint64_t wy_r4(const unsigned char *p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+// 1 to 3 bytes: first, middle and last, which may all be the same byte.
+static inline uint64_t wy_r3(const unsigned char *p, size_t k)
+{
+    return ((uint64_t)p[0] << 16) | ((uint64_t)p[k >> 1] << 8) | p[k - 1];
+}
+
+static uint64_t wyhash(const char *key, size_t length, uint64_t seed)
+{
+    const unsigned char *p = (const unsigned char *)key;
+    uint64_t a, b;
+    seed ^= wy_mix(seed ^ wy_secret[0], wy_secret[1]);
+
+    if (length <= 16)
+    {
+        if (length >= 4)
+        {
+            // 2 overlapping pairs of 4 byte reads cover 4 to 16 bytes.
+            size_t mid = (length >> 3) << 2;
+            a = (wy_r4(p) << 32) | wy_r4(p + mid);
+            b = (wy_r4(p + length - 4) << 32) | wy_r4(p + length - 4 - mid);
+        }
+        else if (length > 0)
+        {
+            a = wy_r3(p, length);
+            b = 0;
+        }
+        else
+        {
+            a = b = 0;
+        }
+    }
+    else
+    {
+        size_t i = length;
+        if (i > 48)
+        {
+            // 3 independent lanes so the multiplies can overlap.
+            uint64_t see1 = seed, see2 = seed;
+            do
+            {
+                seed = wy_mix(wy_r8(p) ^ wy_secret[1], wy_r8(p + 8) ^ seed);
+                see1 = wy_mix(wy_r8(p + 16) ^ wy_secret[2], wy_r8(p + 24) ^ see1);
+                see2 = wy_mix(wy_r8(p + 32) ^ wy_secret[3], wy_r8(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            } while (i > 48);
+            seed ^= see1 ^ see2;
+        }
+        while (i > 16)
+        {
+            seed = wy_mix(wy_r8(p) ^ wy_secret[1], wy_r8(p + 8) ^ seed);
+            p += 16;
+            i -= 16;
+        }
+        // The last 16 bytes, overlapping what we already mixed if need be.
+        a = wy_r8(p + i - 16);
+        b = wy_r8(p + i - 8);
+    }
+
+    a ^= wy_secret[1];
+    b ^= seed;
+    wy_mum(&a, &b);
+    return wy_mix(a ^ wy_secret[0] ^ length, b ^ wy_secret[1]);
+}
+
+uint64_t ht_hash_wyhash(const char *key, size_t length)
+{
+    return wyhash(key, length, 0);
+}
+
+uint64_t ht_hash_seeded(const char *key, size_t length)
+{
+    return wyhash(key, length, hash_seed);
+}
+
+void ht_hash_set_seed(uint64_t seed)
+{
+    hash_seed = seed;
+}
+
+#ifdef HT_HAVE_CRC32C
+/**
+ * @brief 2 CRC32C lanes make 64 bits, and 1 multiply at the end spreads
+ * them out.
+ * @note A CRC is linear, so 2 lanes over the same words would only ever
+ * differ by a constant, 32 bits in all. <hi> gets each word times an odd
+ * constant instead, which a CRC can't undo.
+ * @note Only called once hash_init has seen the CPU supports SSE4.2.
+ */
+__attribute__((target("sse4.2")))
+static uint64_t crc32c_hash(const char *key, size_t length)
+{
+    const unsigned char *p = (const unsigned char *)key;
+    uint64_t lo = (uint32_t)wy_secret[0];
+    uint64_t hi = (uint32_t)wy_secret[1];
+
+    if (length >= 8)
+    {
+        size_t i = length;
+        while (i > 8)
+        {
+            uint64_t word = wy_r8(p);
+            lo = _mm_crc32_u64(lo, word);
+            hi = _mm_crc32_u64(hi, word * wy_secret[2]);
+            p += 8;
+            i -= 8;
+        }
+        // The last 8 bytes, overlapping what we already did if need be.
+        uint64_t word = wy_r8(p + i - 8);
+        lo = _mm_crc32_u64(lo, word);
+        hi = _mm_crc32_u64(hi, word * wy_secret[2]);
+    }
+    else if (length >= 4)
+    {
+        uint64_t word = (wy_r4(p) << 32) | wy_r4(p + length - 4);
+        lo = _mm_crc32_u64(lo, word);
+        hi = _mm_crc32_u64(hi, word * wy_secret[2]);
+    }
+    else if (length > 0)
+    {
+        uint64_t word = wy_r3(p, length);
+        lo = _mm_crc32_u64(lo, word);
+        hi = _mm_crc32_u64(hi, word * wy_secret[2]);
+    }
+    return wy_mix((hi << 32 | lo) ^ wy_secret[3], length ^ wy_secret[1]);
+}
+#endif
+
+uint64_t ht_hash_fast(const char *key, size_t length)
+{
+    return fast_impl(key, length);
+}
+
+/**
+ * @brief Runs before main: picks ht_hash_fast's implementation and a seed.
+ * @note Before main means no threads yet, so neither needs to be atomic.
+ */
+__attribute__((constructor))
+static void hash_init(void)
+{
+    fast_impl = ht_hash_wyhash;
+#ifdef HT_HAVE_CRC32C
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse4.2")) fast_impl = crc32c_hash;
+#endif
+
+    // From the OS if it'll give us some. The clock is only a fallback: a
+    // different seed every run, but one that can be guessed.
+    uint64_t entropy;
+    if (getentropy(&entropy, sizeof(entropy)) == 0)
+    {
+        hash_seed = entropy;
+        return;
+    }
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    entropy = (uint64_t)ts.tv_sec ^ ((uint64_t)ts.tv_nsec << 32);
+    hash_seed = wy_mix(entropy ^ (uint64_t)(uintptr_t)&ts, wy_secret[2]);
+}
@@ -0,0 +1,403 @@
+/**
+ * @file genhashtable_internal.h
+ * @brief "Private" layout of the generic hashtable, shared between the
+ * translation units that implement each backend.
+ * @note Not meant for you, the user, to include. Use genhashtable.h instead.
+ */
+
+#ifndef GENERIC_HASHTABLE_INTERNAL_H
+#define GENERIC_HASHTABLE_INTERNAL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "genhashtable.h"
+
+// Set by ht_open_mmap only, kept clear of the public HT_* flags.
+#define HT_MAPPED 0x80
+
+// Entries per linked list (or per slot) before we grow, see ht_set_max_load.
+#define HT_DEFAULT_MAX_LOAD 1.0
+
+// Most buckets (or slots) a table can have: the biggest power of 2 <size>,
+// an int, holds. Past this, tables just get fuller instead of growing.
+#define HT_MAX_SIZE (1 << 30)
+
+// Shorthand for "singly-linked list". Note the 2 lowercase 'L'.
+struct sllist
+{
+    char *key;            // Copy of the key, NUL terminated for printing.
+    void *obj;            // obj ptr of any type, best to dynamically alloc.
+    struct sllist *next;
+    uint64_t hash;        // Full hash of <key>, checked before the bytes.
+    size_t length;        // # of bytes in <key>, not counting the NUL.
+};
+// Shorthand for "singly-linked list node". Note the 2 lowercase 'L'.
+typedef struct sllist sllnode;
+
+// One entry of the open addressing backend, lives in a flat array.
+struct oa_slot
+{
+    char *key;            // Copy of the key, NUL terminated for printing.
+    void *obj;            // obj ptr of any type, best to dynamically alloc.
+    uint64_t hash;        // Full hash, so we can grow without rehashing keys.
+    size_t length;        // # of bytes in <key>, not counting the NUL.
+};
+
+// Header of every slab/chunk a HT_POOLED table allocates, see pool_release.
+struct ht_slab
+{
+    struct ht_slab *next;
+};
+
+// Node slabs and key arena of a HT_POOLED table, see genhashtable_pool.c.
+struct ht_pool
+{
+    struct ht_slab *node_slabs;     // Every slab nodes were carved from.
+    struct ht_slab *key_chunks;     // Every chunk keys were bumped into.
+    void *free_nodes;               // Deleted nodes, linked via 1st pointer.
+    char *node_next, *node_end;     // Uncarved part of the newest slab.
+    char *key_next, *key_end;       // Unused part of the newest key chunk.
+    size_t node_size;               // Bytes per node, rounded up.
+    size_t slab_nodes;              // # of nodes in the next slab.
+    size_t chunk_bytes;             // # of bytes in the next key chunk.
+    size_t slabs;                   // # of slabs and chunks malloc'd.
+    size_t bytes;                   // Their total size.
+};
+
+// Extra links of every HT_CACHE node, right after it and before its value.
+struct ht_cache_links
+{
+    sllnode *newer, *older;         // Neighbours in the eviction queue.
+    size_t cost;                    // # of bytes charged for this entry.
+    bool visited;                   // HT_EVICT_SIEVE: hit since the hand passed.
+};
+
+// Budget and eviction queue of a HT_CACHE table, see genhashtable_cache.c.
+struct ht_cache
+{
+    sllnode *newest, *oldest;       // Ends of the eviction queue.
+    sllnode *hand;                  // HT_EVICT_SIEVE: next to check, or NULL.
+    size_t bytes;                   // Sum of every entry's cost.
+    size_t max_entries;             // 0 for no limit.
+    size_t max_bytes;               // 0 for no limit.
+    unsigned policy;                // HT_EVICT_*.
+    cost_function *cost_fn;         // Optional, weighs each obj.
+    uint64_t hits, misses, evictions;
+};
+
+// 1 blocked Bloom filter, see genhashtable_bloom.c.
+struct bloom_filter
+{
+    uint64_t *blocks;               // <nblocks> blocks of 64 bytes, or NULL.
+    size_t nblocks;                 // Always a power of 2.
+    void *raw;                      // What to free, <blocks> is aligned in it.
+    size_t deleted;                 // # of keys deleted since it was filled.
+};
+
+// Filters of a HT_BLOOM table. <next> is filled a few buckets at a time
+// and then replaces <now>, so neither growing nor cleaning up ever walks
+// the whole table in 1 call. Until then, <now> still has every key.
+struct ht_bloom
+{
+    struct bloom_filter now;        // Has every key, <blocks> NULL if none yet.
+    struct bloom_filter next;       // <blocks> NULL unless we're filling it.
+    size_t fill_idx;                // Buckets (or slots) below this are in it.
+    uint64_t negatives;             // # of misses the filter answered alone.
+    uint64_t false_positives;       // # of misses it let through anyway.
+};
+
+// Only counted for HT_COUNTERS tables, see ht_stats.
+struct ht_counters
+{
+    uint64_t lookups;
+    uint64_t probes;
+    uint64_t compares;
+    uint64_t allocations;
+};
+
+// <hashtable> will update when <generic_hashtable> updates.
+struct generic_hashtable
+{
+    int size;                       // Total # of linked lists or slots.
+    unsigned flags;                 // HT_* flags passed to ht_create.
+    uint64_t collisions;            // Total # of collisions in the table.
+    hash_function *hash_fn;         // Generates hash value from string key.
+    cleanup_function *clean_fn;     // Custom object cleanup fn, or <free>.
+    sllnode **elements;             // 1D array of linked lists for collisions.
+    size_t count;                   // # of live entries.
+    double max_load;                // Grow once count > size * max_load.
+
+    // While growing, linked lists still waiting to be moved to <elements>.
+    sllnode **old_elements;         // <NULL> unless we're mid-resize.
+    int old_size;                   // # of linked lists in <old_elements>.
+    size_t rehash_idx;              // Old lists below this have been moved.
+
+    // Only used by HT_OPEN_ADDRESSING tables, see genhashtable_oa.c.
+    uint8_t *ctrl;                  // 1 metadata byte per slot.
+    struct oa_slot *slots;          // Flat array of <size> entries.
+    size_t tombstones;              // # of DELETED slots.
+
+    // Only used by HT_POOLED tables.
+    struct ht_pool pool;
+
+    // Only used by HT_COUNTERS tables.
+    struct ht_counters counters;
+
+    // Only used by tables from ht_create_sized. Chained tables keep each
+    // value right after its node, open addressing ones in <values>.
+    size_t value_size;              // 0 if objs are pointers as usual.
+    uint8_t *values;                // <size> * <value_size> bytes.
+
+    // Only used by HT_CONCURRENT tables, see genhashtable_concurrent.c.
+    struct ht_concurrent *cc;
+
+    // Only used by HT_CACHE tables.
+    struct ht_cache cache;
+
+    // Only used by HT_BLOOM tables.
+    struct ht_bloom bloom;
+
+    // Only used by tables from ht_open_mmap, see genhashtable_mmap.c.
+    const char *map;                // The whole file, read-only.
+    size_t map_size;                // # of bytes mapped.
+};
+
+/** 
+ * @brief "private" function to properly call the hash_fn. 
+ * @return uint64_t of the resulting hashed value, not yet masked.
+ * @note  Check if <ht> and <key> are both not <NULL> before calling this.
+*/
+uint64_t ht_hash(table *ht, const char *key, size_t length);
+
+// Bit 0 becomes bit 63 and so on, for scan cursors.
+static inline uint64_t ht_reverse_bits(uint64_t x)
+{
+    x = ((x >> 1) & 0x5555555555555555ULL) | ((x & 0x5555555555555555ULL) << 1);
+    x = ((x >> 2) & 0x3333333333333333ULL) | ((x & 0x3333333333333333ULL) << 2);
+    x = ((x >> 4) & 0x0F0F0F0F0F0F0F0FULL) | ((x & 0x0F0F0F0F0F0F0F0FULL) << 4);
+    return __builtin_bswap64(x);
+}
+
+/**
+ * @brief Which of <size> linked lists a hash belongs to.
+ * @note <size> is always a power of 2, so masking is the same as modulo.
+ */
+static inline size_t ht_bucket(uint64_t hash, int size)
+{
+    return (size_t)(hash & (uint64_t)(size - 1));
+}
+
+static inline bool ht_rehashing(table *ht)
+{
+    return ht->old_elements != NULL;
+}
+
+/**
+ * @brief # of bytes in 1 linked list node, not counting its inline value.
+ * @note HT_CACHE nodes have their struct ht_cache_links tacked on.
+ */
+static inline size_t ht_node_bytes(table *ht)
+{
+    if (!(ht->flags & HT_CACHE)) return sizeof(sllnode);
+    return sizeof(sllnode) + sizeof(struct ht_cache_links);
+}
+
+// Where <node>'s inline value lives, if the table has them.
+static inline void *ht_node_value(table *ht, sllnode *node)
+{
+    return (char *)node + ht_node_bytes(ht);
+}
+
+static inline struct ht_cache_links *ht_links(sllnode *node)
+{
+    return (struct ht_cache_links *)(node + 1);
+}
+
+// The node whose obj pointer is at <slot>.
+static inline sllnode *ht_slot_node(void **slot)
+{
+    return (sllnode *)((char *)slot - offsetof(sllnode, obj));
+}
+
+// Weigh <node>'s obj again now that it's stored, see genhashtable_cache.c.
+void cache_charge(table *ht, sllnode *node);
+
+/**
+ * @brief Start a new entry's obj off: NULL, or <value> zeroed out.
+ * @return What the entry's obj pointer should be.
+ */
+static inline void *ht_value_init(table *ht, void *value)
+{
+    if (ht->value_size == 0) return NULL;
+
+    memset(value, 0, ht->value_size);
+    return value;
+}
+
+/**
+ * @brief Store <obj> in the entry whose obj pointer is at <slot>.
+ * @note Inline values are copied from <obj>, the pointer stays put.
+ */
+static inline void ht_store(table *ht, void **slot, void *obj)
+{
+    if (ht->value_size != 0)
+        memcpy(*slot, obj, ht->value_size);
+    else
+        *slot = obj;
+
+    if (ht->flags & HT_CACHE) cache_charge(ht, ht_slot_node(slot));
+}
+
+// Add <n> to 1 of <ht->counters>, if the table counts at all.
+static inline void ht_count(table *ht, uint64_t *counter, uint64_t n)
+{
+    if (!(ht->flags & HT_COUNTERS)) return;
+
+    // Lock-free readers bump these from many threads at once.
+    if (ht->flags & HT_CONCURRENT)
+        __atomic_fetch_add(counter, n, __ATOMIC_RELAXED);
+    else
+        *counter += n;
+}
+
+// 1 lookup that visited <probes> nodes or groups and compared <compares> keys.
+static inline void ht_count_lookup(table *ht, uint64_t probes, 
+                                   uint64_t compares)
+{
+    if (!(ht->flags & HT_COUNTERS)) return;
+
+    ht_count(ht, &ht->counters.lookups, 1);
+    ht_count(ht, &ht->counters.probes, probes);
+    ht_count(ht, &ht->counters.compares, compares);
+}
+
+/**
+ * @brief Walk <key>'s linked list(s) once, <hash> is already computed.
+ * @return Address of <key>'s obj. If it's not there and <insert> is true,
+ * a new entry with a <NULL> obj is added and <*inserted> is set to true.
+ * @return <NULL> if <key> isn't there and we didn't (or couldn't) add it.
+ * @note Both backends share this contract, it's what every lookup uses.
+ * @note Not for HT_CONCURRENT tables, those go through the cc_* functions.
+ */
+void **ht_probe_hashed(table *ht, const char *key, size_t length,
+                       uint64_t hash, bool insert, bool *inserted);
+
+/**
+ * @brief Copy <length> bytes of <key> and NUL terminate the copy.
+ * @return The copy, or NULL if we ran out of memory.
+ * @note The copy comes from the key arena if <ht> is HT_POOLED.
+ * Either way, give it back with ht_key_free and not free.
+ */
+char *ht_key_copy(table *ht, const char *key, size_t length);
+void ht_key_free(table *ht, char *key);
+
+/**
+ * @brief Unlink <node> from its linked list, clean its obj and free it.
+ * @note For HT_CACHE evictions, <node> must be in the table.
+ */
+void ht_evict(table *ht, sllnode *node);
+
+// Finish a resize in progress right now, instead of a few lists at a time.
+void ht_rehash_finish(table *ht);
+
+/**
+ * @brief The scan cursor after <cursor>, for a table of <mask> + 1 buckets.
+ * @note Counts up in the high bits of <mask> first, reversed. Then growing
+ * the table only splits buckets into ones the cursor hasn't reached yet.
+ */
+static inline uint64_t ht_cursor_next(uint64_t cursor, uint64_t mask)
+{
+    cursor |= ~mask;
+    cursor = ht_reverse_bits(cursor) + 1;
+    return ht_reverse_bits(cursor);
+}
+
+// Add 1 linked list of <length> entries to <stats>, see genhashtable_stats.c.
+void ht_stats_chain(struct ht_stats *stats, size_t length);
+
+// Set every field of a freshly malloc'd <ht> to what an empty table of
+// <size> buckets has, before any arrays are allocated. Shared by
+// ht_create_sized and ht_open_mmap so neither can miss a field.
+void ht_init_fields(table *ht, int size, unsigned flags, hash_function *hf,
+                    cleanup_function *cf, size_t value_size);
+
+// Locks and epochs of HT_CONCURRENT tables. Same contracts as the public
+// functions, except <hash> is already computed.
+bool cc_init(table *ht);
+void cc_destroy(table *ht);
+void cc_pin(table *ht);
+void cc_unpin(table *ht);
+void *cc_find(table *ht, const char *key, size_t length, uint64_t hash);
+bool cc_insert(table *ht, const char *key, size_t length, uint64_t hash,
+               void *obj);
+bool cc_upsert(table *ht, const char *key, size_t length, uint64_t hash,
+               void *obj, bool replace_only);
+bool cc_delete(table *ht, const char *key, size_t length, uint64_t hash);
+size_t cc_bytes(table *ht);
+
+// Eviction queue of HT_CACHE tables. Every node is admitted once it's
+// linked in, touched on every hit and forgotten just before it's freed.
+// Admitting or charging may evict other entries, but never <node>.
+void cache_init(table *ht);
+void cache_admit(table *ht, sllnode *node);
+void cache_touch(table *ht, sllnode *node);
+void cache_forget(table *ht, sllnode *node);
+
+// Bloom filter of HT_BLOOM tables. bloom_maybe is false only if no key
+// with <hash> can be in the table. bloom_add goes after an insert,
+// bloom_forget after a delete, bloom_rebuild after anything that links
+// entries in behind ht_probe_hashed's back. bloom_resize goes after the
+// table moved to a new array, bloom_moved for every node a resize step
+// moves from the old array to the new one.
+void bloom_init(table *ht);
+void bloom_destroy(table *ht);
+bool bloom_maybe(table *ht, uint64_t hash);
+void bloom_add(table *ht, uint64_t hash);
+void bloom_forget(table *ht);
+void bloom_rebuild(table *ht);
+void bloom_resize(table *ht);
+void bloom_moved(table *ht, uint64_t hash);
+void bloom_prefetch(table *ht, uint64_t hash);
+void bloom_stats(table *ht, struct ht_stats *stats);
+
+// Slab/arena allocator of HT_POOLED tables.
+void pool_init(struct ht_pool *pool, size_t node_size);
+void *pool_node_alloc(struct ht_pool *pool);
+void *pool_node_bulk(struct ht_pool *pool, size_t count);
+void pool_node_free(struct ht_pool *pool, void *node);
+char *pool_key_alloc(struct ht_pool *pool, size_t bytes);
+void pool_release(struct ht_pool *pool);
+
+// Open addressing backend. <ht->hash_fn> and <ht->clean_fn> are set already.
+// oa_scan and map_scan do 1 step of ht_scan and add what <fn> saw to <seen>.
+// oa_probe returns the address of <key>'s obj, adding a <NULL> one if
+// <insert> is true and the key is new. Same contract as ht_find_or_insert.
+// <hash> is always ht->hash_fn(key, length), the caller computes it once.
+bool oa_init(table *ht, int size);
+void oa_destroy(table *ht);
+void oa_print(table *ht);
+void **oa_probe(table *ht, const char *key, size_t length, uint64_t hash,
+                bool insert, bool *inserted);
+bool oa_delete(table *ht, const char *key, size_t length, uint64_t hash);
+uint64_t oa_scan(table *ht, uint64_t cursor, scan_function *fn, void *arg,
+                 size_t *seen);
+void oa_prefetch(table *ht, uint64_t hash);
+void oa_stats(table *ht, struct ht_stats *stats);
+
+// Read-only tables mapped by ht_open_mmap. map_find returns the address of
+// the value's bytes inside the file, or NULL if <key> isn't there.
+void map_close(table *ht);
+void *map_find(table *ht, const char *key, size_t length, uint64_t hash);
+void map_prefetch(table *ht, uint64_t hash);
+void map_print(table *ht);
+bool map_iter_next(table *ht, size_t *offset, const char **key,
+                   size_t *length, void **obj);
+uint64_t map_scan(table *ht, uint64_t cursor, scan_function *fn, void *arg,
+                  size_t *seen);
+void map_stats(table *ht, struct ht_stats *stats);
+
+#endif // GENERIC_HASHTABLE_INTERNAL_H
@@ -0,0 +1,144 @@
+/**
+ * @file genhashtable_iter.c
+ * @brief Walking every entry of a table: ht_iter_* in 1 go, ht_scan in
+ * slices that survive the table changing in between.
+ *
+ * ht_scan's cursor is a bucket index, counted up with its bits reversed,
+ * the way Redis's SCAN does it. Growing doubles the # of buckets, and
+ * bucket i splits into i and i + old size. Both of those come after i in
+ * reversed order, so no bucket the cursor has yet to reach can end up
+ * behind it. Mid-resize, we visit bucket i of the old array and then every
+ * bucket of the new one it's split into.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "genhashtable_internal.h"
+
+// Give only the outputs the caller asked for.
+static inline void iter_output(const char *key, size_t length, void *obj,
+                               const char **key_out, size_t *length_out,
+                               void **obj_out)
+{
+    if (key_out != NULL) *key_out = key;
+    if (length_out != NULL) *length_out = length;
+    if (obj_out != NULL) *obj_out = obj;
+}
+
+void ht_iter_begin(table *ht, ht_iter *it)
+{
+    it->ht = ht;
+    it->idx = 0;
+    it->next = NULL;
+
+    // ht_find could move lists from 1 array to the other under us.
+    if (ht != NULL && !(ht->flags & HT_OPEN_ADDRESSING) && ht_rehashing(ht))
+        ht_rehash_finish(ht);
+}
+
+bool ht_iter_next(ht_iter *it, const char **key, size_t *length, void **obj)
+{
+    table *ht = it->ht;
+    if (ht == NULL) return false;
+
+    if (ht->flags & HT_MAPPED)
+    {
+        const char *entry_key;
+        size_t entry_length;
+        void *entry_obj;
+        if (!map_iter_next(ht, &it->idx, &entry_key, &entry_length, &entry_obj))
+            return false;
+        iter_output(entry_key, entry_length, entry_obj, key, length, obj);
+        return true;
+    }
+
+    if (ht->flags & HT_OPEN_ADDRESSING)
+    {
+        while (it->idx < (size_t)ht->size && (ht->ctrl[it->idx] & 0x80))
+            it->idx++;
+        if (it->idx >= (size_t)ht->size) return false;
+
+        struct oa_slot *slot = &ht->slots[it->idx++];
+        iter_output(slot->key, slot->length, slot->obj, key, length, obj);
+        return true;
+    }
+
+    // Loads are atomic so HT_CONCURRENT writers can keep going.
+    sllnode *node = it->next;
+    while (node == NULL)
+    {
+        if (it->idx >= (size_t)ht->size) return false;
+        node = __atomic_load_n(&ht->elements[it->idx++], __ATOMIC_ACQUIRE);
+    }
+
+    // Remember the next one now, the caller may delete this one.
+    it->next = __atomic_load_n(&node->next, __ATOMIC_ACQUIRE);
+    iter_output(node->key, node->length, node->obj, key, length, obj);
+    return true;
+}
+
+static void scan_list(sllnode *node, scan_function *fn, void *arg,
+                      size_t *seen)
+{
+    while (node != NULL)
+    {
+        fn(node->key, node->length, node->obj, arg);
+        (*seen)++;
+        node = __atomic_load_n(&node->next, __ATOMIC_ACQUIRE);
+    }
+}
+
+static sllnode *scan_head(sllnode **elements, size_t idx)
+{
+    return __atomic_load_n(&elements[idx], __ATOMIC_ACQUIRE);
+}
+
+// 1 step of ht_scan for chained tables, see the top of this file.
+static uint64_t chain_scan(table *ht, uint64_t cursor, scan_function *fn,
+                           void *arg, size_t *seen)
+{
+    uint64_t mask = (uint64_t)ht->size - 1;
+    if (!ht_rehashing(ht))
+    {
+        scan_list(scan_head(ht->elements, cursor & mask), fn, arg, seen);
+        return ht_cursor_next(cursor, mask);
+    }
+
+    // Old lists below <rehash_idx> are empty, they've been moved already.
+    uint64_t old_mask = (uint64_t)ht->old_size - 1;
+    size_t old_idx = (size_t)(cursor & old_mask);
+    if (old_idx >= ht->rehash_idx)
+        scan_list(scan_head(ht->old_elements, old_idx), fn, arg, seen);
+
+    // Then every new list that old one splits into.
+    do
+    {
+        scan_list(scan_head(ht->elements, cursor & mask), fn, arg, seen);
+        cursor = ht_cursor_next(cursor, mask);
+    } while (cursor & (old_mask ^ mask));
+    return cursor;
+}
+
+uint64_t ht_scan(table *ht, uint64_t cursor, size_t count, scan_function *fn,
+                 void *arg)
+{
+    if (ht == NULL || fn == NULL) return 0;
+
+    // Don't let a long run of empty buckets make 1 call slow either.
+    size_t seen = 0;
+    size_t steps = (count != 0) ? count * 10 : 1;
+    ht_pin(ht);
+    do
+    {
+        if (ht->flags & HT_MAPPED)
+            cursor = map_scan(ht, cursor, fn, arg, &seen);
+        else if (ht->flags & HT_OPEN_ADDRESSING)
+            cursor = oa_scan(ht, cursor, fn, arg, &seen);
+        else
+            cursor = chain_scan(ht, cursor, fn, arg, &seen);
+    } while (cursor != 0 && seen < count && --steps != 0);
+    ht_unpin(ht);
+    return cursor;
+}
@@ -0,0 +1,484 @@
+/**
+ * @file genhashtable_mmap.c
+ * @brief Snapshots of a table on disk, and read-only tables mapped from them.
+ *
+ * The file has no pointers in it, only offsets from its first byte:
+ *
+ *     header | directory: uint64_t[buckets + 1] | entries, bucket by bucket
+ *
+ * Bucket i's entries sit back to back from directory[i] to directory[i + 1].
+ * Each entry is a map_entry, then its value padded to 8 bytes, then its
+ * NUL terminated key padded to 8 bytes. So a lookup reads 1 directory slot
+ * and 1 short run of entries, and only those pages ever get faulted in.
+ * @note Keys are always indexed with ht_hash_wyhash, whatever the table used,
+ * since that one hashes the same in every process.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "genhashtable_internal.h"
+
+#define MAP_MAGIC  "GENHT01"            // 7 chars and the NUL, 8 bytes.
+#define MAP_ENDIAN 0x0102030405060708ULL // Reads back different if swapped.
+
+struct map_header
+{
+    char magic[8];
+    uint64_t endian;
+    uint64_t count;                 // # of entries.
+    uint64_t buckets;               // # of buckets, a power of 2.
+    uint64_t collisions;            // Entries that didn't get a bucket alone.
+    uint64_t file_size;             // Catches files cut short.
+};
+
+struct map_entry
+{
+    uint64_t hash;                  // ht_hash_wyhash of the key.
+    uint32_t key_length;            // Not counting the NUL.
+    uint32_t value_length;          // As returned by the serialize function.
+};
+
+// What ht_save remembers about each entry before writing it out.
+struct save_entry
+{
+    const char *key;
+    size_t length;
+    void *obj;
+    uint64_t hash;
+    size_t value_length;
+};
+
+static inline size_t pad8(size_t bytes)
+{
+    return (bytes + 7) & ~(size_t)7;
+}
+
+static inline size_t map_entry_size(size_t key_length, size_t value_length)
+{
+    return sizeof(struct map_entry) + pad8(value_length) + pad8(key_length + 1);
+}
+
+static inline const uint64_t *map_directory(table *ht)
+{
+    return (const uint64_t *)(ht->map + sizeof(struct map_header));
+}
+
+/**
+ * @brief Note down 1 entry for ht_save, asking <sf> how big its value is.
+ * @return false if the key or value is too big for the file format.
+ */
+static bool save_add(struct save_entry *entries, size_t *n, size_t capacity,
+                     const char *key, size_t length, void *obj,
+                     serialize_function *sf)
+{
+    if (*n == capacity) return false;
+    size_t value_length = sf(obj, NULL, 0);
+    if (length > UINT32_MAX || value_length > UINT32_MAX) return false;
+
+    entries[*n] = (struct save_entry){key, length, obj,
+                                      ht_hash_wyhash(key, length), value_length};
+    (*n)++;
+    return true;
+}
+
+// Every live entry of <ht>, whichever backend it is, goes into <entries>.
+static bool save_collect(table *ht, struct save_entry *entries, size_t *n,
+                         size_t capacity, serialize_function *sf)
+{
+    if (ht->flags & HT_OPEN_ADDRESSING)
+    {
+        for (int i = 0; i < ht->size; i++)
+        {
+            if (ht->ctrl[i] & 0x80) continue;
+            struct oa_slot *slot = &ht->slots[i];
+            if (!save_add(entries, n, capacity, slot->key, slot->length,
+                          slot->obj, sf))
+                return false;
+        }
+        return true;
+    }
+
+    // Lists below <rehash_idx> were moved already and are empty.
+    sllnode **arrays[] = {ht->elements, ht->old_elements};
+    int sizes[] = {ht->size, ht->old_size};
+    for (size_t a = 0; a < 2; a++)
+    {
+        for (int i = 0; arrays[a] != NULL && i < sizes[a]; i++)
+        {
+            for (sllnode *tmp = arrays[a][i]; tmp != NULL; tmp = tmp->next)
+            {
+                if (!save_add(entries, n, capacity, tmp->key, tmp->length,
+                              tmp->obj, sf))
+                    return false;
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Write every entry of <entries> bucket by bucket to <file>.
+ * @note <entries> must already be sorted by bucket.
+ */
+static bool save_write(FILE *file, const struct save_entry *entries, size_t n,
+                       const uint64_t *directory, uint64_t buckets,
+                       uint64_t collisions, serialize_function *sf)
+{
+    struct map_header header = {MAP_MAGIC, MAP_ENDIAN, n, buckets, collisions,
+                                directory[buckets]};
+    if (fwrite(&header, sizeof(header), 1, file) != 1) return false;
+    if (fwrite(directory, sizeof(uint64_t), buckets + 1, file) != buckets + 1)
+        return false;
+
+    // Each entry is put together in 1 scratch buffer, then written at once.
+    char *buffer = NULL;
+    size_t capacity = 0;
+    bool ok = true;
+    for (size_t i = 0; ok && i < n; i++)
+    {
+        const struct save_entry *e = &entries[i];
+        size_t size = map_entry_size(e->length, e->value_length);
+        if (size > capacity)
+        {
+            char *bigger = realloc(buffer, size);
+            if (bigger == NULL)
+            {
+                ok = false;
+                break;
+            }
+            buffer = bigger;
+            capacity = size;
+        }
+        // Padding is 0s, so the same table always gives the same file.
+        memset(buffer, 0, size);
+        struct map_entry entry = {e->hash, (uint32_t)e->length,
+                                  (uint32_t)e->value_length};
+        memcpy(buffer, &entry, sizeof(entry));
+
+        // It told us the size once already, it'd better not change its mind.
+        char *value = buffer + sizeof(entry);
+        ok = sf(e->obj, value, e->value_length) == e->value_length;
+        memcpy(value + pad8(e->value_length), e->key, e->length);
+        ok = ok && fwrite(buffer, 1, size, file) == size;
+    }
+    free(buffer);
+    return ok;
+}
+
+/**
+ * @brief fsync the directory <path> is in, so a rename into it is on disk.
+ * @note Some file systems can't fsync a directory at all (EINVAL), those
+ * get nothing better from us either.
+ */
+static bool save_sync_dir(const char *path)
+{
+    const char *slash = strrchr(path, '/');
+    char *dir = (slash == NULL) ? strdup(".")
+              : (slash == path) ? strdup("/")
+              : strndup(path, (size_t)(slash - path));
+    if (dir == NULL) return false;
+
+    int fd = open(dir, O_RDONLY | O_DIRECTORY);
+    free(dir);
+    if (fd == -1) return false;
+
+    bool ok = fsync(fd) == 0 || errno == EINVAL;
+    close(fd);
+    return ok;
+}
+
+bool ht_save(table *ht, const char *path, serialize_function *sf)
+{
+    if (ht == NULL || path == NULL || sf == NULL) return false;
+    if (ht->flags & HT_MAPPED)
+    {
+        printf("Mapped tables are already saved, copy the file instead!\n");
+        return false;
+    }
+
+    // 1 bucket per entry, like a fresh chained table at max load 1.0.
+    uint64_t buckets = 1;
+    while (buckets < ht->count) buckets *= 2;
+
+    // +1 so an empty table doesn't malloc 0 bytes.
+    struct save_entry *entries = malloc((ht->count + 1) * sizeof(*entries));
+    struct save_entry *sorted = malloc((ht->count + 1) * sizeof(*sorted));
+    uint64_t *directory = calloc(buckets + 1, sizeof(uint64_t));
+    size_t n = 0;
+    bool ok = entries != NULL && sorted != NULL && directory != NULL
+              && save_collect(ht, entries, &n, ht->count, sf);
+
+    if (ok)
+    {
+        // Counting sort by bucket: bytes per bucket first...
+        uint64_t collisions = 0;
+        for (size_t i = 0; i < n; i++)
+        {
+            uint64_t *bytes = &directory[entries[i].hash & (buckets - 1)];
+            if (*bytes != 0) collisions++;
+            *bytes += map_entry_size(entries[i].length, entries[i].value_length);
+        }
+
+        // ...then turned into where each bucket starts...
+        uint64_t offset = sizeof(struct map_header)
+                          + (buckets + 1) * sizeof(uint64_t);
+        for (uint64_t b = 0; b <= buckets; b++)
+        {
+            uint64_t bytes = directory[b];
+            directory[b] = offset;
+            offset += bytes;
+        }
+
+        // ...then the same again counting entries, so <sorted> is in the
+        // exact order the entries will be written in.
+        uint64_t *cursor = calloc(buckets, sizeof(uint64_t));
+        ok = cursor != NULL;
+        for (size_t i = 0; ok && i < n; i++)
+            cursor[entries[i].hash & (buckets - 1)]++;
+        for (uint64_t b = 0, start = 0; ok && b < buckets; b++)
+        {
+            uint64_t count = cursor[b];
+            cursor[b] = start;
+            start += count;
+        }
+        for (size_t i = 0; ok && i < n; i++)
+            sorted[cursor[entries[i].hash & (buckets - 1)]++] = entries[i];
+        free(cursor);
+
+        // Write somewhere else first, so a crash never leaves half a file:
+        // it's all on disk before the rename, and the rename is before we
+        // return.
+        size_t tmp_length = strlen(path) + sizeof(".tmp");
+        char *tmp_path = malloc(tmp_length);
+        FILE *file = NULL;
+        if (ok && tmp_path != NULL)
+        {
+            snprintf(tmp_path, tmp_length, "%s.tmp", path);
+            file = fopen(tmp_path, "wb");
+        }
+        ok = file != NULL
+             && save_write(file, sorted, n, directory, buckets, collisions, sf)
+             && fflush(file) == 0 && fsync(fileno(file)) == 0;
+        if (file != NULL && fclose(file) != 0) ok = false;
+        bool renamed = ok && rename(tmp_path, path) == 0;
+        if (!renamed && file != NULL) remove(tmp_path);
+        ok = renamed && save_sync_dir(path);
+        free(tmp_path);
+    }
+
+    if (!ok) printf("Failed to save hashtable to '%s'!\n", path);
+    free(entries);
+    free(sorted);
+    free(directory);
+    return ok;
+}
+
+table *ht_open_mmap(const char *path)
+{
+    if (path == NULL) return NULL;
+
+    int fd = open(path, O_RDONLY);
+    if (fd == -1)
+    {
+        printf("Failed to open hashtable file '%s'!\n", path);
+        return NULL;
+    }
+    struct stat st;
+    void *map = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(struct map_header))
+        map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    // The mapping keeps the file alive on its own.
+    close(fd);
+    if (map == MAP_FAILED)
+    {
+        printf("Failed to map hashtable file '%s'!\n", path);
+        return NULL;
+    }
+
+    // Only the header is checked up front, entries are checked as we go.
+    const struct map_header *header = map;
+    uint64_t directory_end = sizeof(*header)
+                             + (header->buckets + 1) * sizeof(uint64_t);
+    if (memcmp(header->magic, MAP_MAGIC, sizeof(header->magic)) != 0
+        || header->endian != MAP_ENDIAN
+        || header->file_size != (uint64_t)st.st_size
+        || header->buckets == 0 || header->buckets > INT32_MAX
+        || (header->buckets & (header->buckets - 1)) != 0
+        || directory_end > header->file_size)
+    {
+        printf("'%s' isn't a hashtable file, or not one from this machine!\n",
+            path);
+        munmap(map, (size_t)st.st_size);
+        return NULL;
+    }
+
+    table *ht = malloc(sizeof(*ht));
+    if (ht == NULL)
+    {
+        printf("Failed to allocate memory for hashtable!\n");
+        munmap(map, (size_t)st.st_size);
+        return NULL;
+    }
+    ht_init_fields(ht, (int)header->buckets, HT_MAPPED, ht_hash_wyhash,
+                   NULL, 0);
+    ht->collisions = header->collisions;
+    ht->count = header->count;
+    ht->map = map;
+    ht->map_size = (size_t)st.st_size;
+
+    // Lookups jump all over the file, reading ahead would only waste I/O.
+    madvise(map, ht->map_size, MADV_RANDOM);
+    return ht;
+}
+
+void map_close(table *ht)
+{
+    munmap((void *)ht->map, ht->map_size);
+}
+
+void *map_find(table *ht, const char *key, size_t length, uint64_t hash)
+{
+    const uint64_t *directory = map_directory(ht);
+    size_t bucket = ht_bucket(hash, ht->size);
+    uint64_t offset = directory[bucket];
+    uint64_t end = directory[bucket + 1];
+    if (end > ht->map_size || offset > end) return NULL;
+
+    uint64_t probes = 0, compares = 0;
+    const char *found = NULL;
+    while (found == NULL && end - offset >= sizeof(struct map_entry))
+    {
+        const struct map_entry *entry = (const void *)(ht->map + offset);
+        size_t size = map_entry_size(entry->key_length, entry->value_length);
+        if (size > end - offset) break;
+
+        probes++;
+        const char *value = (const char *)(entry + 1);
+        if (entry->hash == hash && entry->key_length == length)
+        {
+            compares++;
+            if (memcmp(value + pad8(entry->value_length), key, length) == 0)
+                found = value;
+        }
+        offset += size;
+    }
+    ht_count_lookup(ht, probes, compares);
+    return (void *)found;
+}
+
+void map_stats(table *ht, struct ht_stats *stats)
+{
+    const uint64_t *directory = map_directory(ht);
+    stats->bytes += ht->map_size;
+    for (int i = 0; i < ht->size; i++)
+    {
+        uint64_t offset = directory[i];
+        uint64_t end = directory[i + 1];
+        size_t length = 0;
+        while (end <= ht->map_size && offset < end
+               && end - offset >= sizeof(struct map_entry))
+        {
+            const struct map_entry *entry = (const void *)(ht->map + offset);
+            offset += map_entry_size(entry->key_length, entry->value_length);
+            length++;
+        }
+        ht_stats_chain(stats, length);
+    }
+}
+
+/**
+ * @brief Read the entry at <*offset> and move <*offset> past it.
+ * @param offset 0 for the 1st entry, then what the last call left there.
+ * @return false at the end of the entries, or if the file is cut short.
+ * @note Buckets are back to back, so this walks all of them in order.
+ */
+bool map_iter_next(table *ht, size_t *offset, const char **key,
+                   size_t *length, void **obj)
+{
+    // Offset 0 is the header, so that means start from the 1st entry.
+    if (*offset == 0) *offset = map_directory(ht)[0];
+    uint64_t end = map_directory(ht)[ht->size];
+    if (end > ht->map_size || *offset >= end 
+        || end - *offset < sizeof(struct map_entry))
+        return false;
+
+    const struct map_entry *entry = (const void *)(ht->map + *offset);
+    size_t size = map_entry_size(entry->key_length, entry->value_length);
+    if (size > end - *offset) return false;
+
+    const char *value = (const char *)(entry + 1);
+    *key = value + pad8(entry->value_length);
+    *length = entry->key_length;
+    *obj = (void *)value;
+    *offset += size;
+    return true;
+}
+
+// 1 step of ht_scan: 1 bucket, the file never grows.
+uint64_t map_scan(table *ht, uint64_t cursor, scan_function *fn, void *arg,
+                  size_t *seen)
+{
+    size_t mask = (size_t)ht->size - 1;
+    size_t bucket = (size_t)cursor & mask;
+    size_t offset = map_directory(ht)[bucket];
+    size_t end = map_directory(ht)[bucket + 1];
+
+    const char *key;
+    size_t length;
+    void *obj;
+    while (offset < end && map_iter_next(ht, &offset, &key, &length, &obj))
+    {
+        fn(key, length, obj, arg);
+        (*seen)++;
+    }
+    return ht_cursor_next(cursor, mask);
+}
+
+void map_prefetch(table *ht, uint64_t hash)
+{
+    __builtin_prefetch(&map_directory(ht)[ht_bucket(hash, ht->size)]);
+}
+
+void map_print(table *ht)
+{
+    const uint64_t *directory = map_directory(ht);
+    int empty_lists = 0;
+    printf("---- START TABLE ----\n");
+    for (int i = 0; i < ht->size; i++)
+    {
+        uint64_t offset = directory[i];
+        uint64_t end = directory[i + 1];
+        if (offset >= end || end > ht->map_size)
+        {
+            empty_lists++;
+            continue;
+        }
+
+        printf("%4i: ", i);
+        while (end - offset >= sizeof(struct map_entry))
+        {
+            const struct map_entry *entry = (const void *)(ht->map + offset);
+            size_t size = map_entry_size(entry->key_length, entry->value_length);
+            if (size > end - offset) break;
+
+            const char *value = (const char *)(entry + 1);
+            printf("%s", value + pad8(entry->value_length));
+            offset += size;
+            if (end - offset >= sizeof(struct map_entry)) printf(", ");
+        }
+        printf("\n");
+    }
+    printf("We have %zu total collisions and %i empty lists in the table.\n",
+        ht_collisions(ht), empty_lists);
+    printf("---- END TABLE ----\n\n");
+}
@@ -0,0 +1,451 @@
+/**
+ * @file genhashtable_oa.c
+ * @brief Open addressing backend for the generic hashtable.
+ * Selected by passing HT_OPEN_ADDRESSING to ht_create.
+ *
+ * Every slot has 1 control byte next to it in a separate array:
+ * EMPTY, DELETED (a tombstone) or the low 7 bits of the key's hash.
+ * Slots are grouped by 16 so 1 SSE2 compare checks a whole group's control
+ * bytes at once, and we only touch a slot's key when its 7 bits match.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "genhashtable_internal.h"
+
+#define GROUP_WIDTH 16
+#define CTRL_EMPTY   ((uint8_t)0x80) // Never used, ends a probe sequence.
+#define CTRL_DELETED ((uint8_t)0xFE) // Used to be full, keep probing.
+
+// Bit <i> of a group mask is set if slot <i> of the group matched.
+typedef uint32_t group_mask;
+
+static inline uint8_t oa_h2(uint64_t hash)
+{
+    return (uint8_t)(hash & 0x7F);
+}
+
+static inline size_t oa_h1(uint64_t hash)
+{
+    return (size_t)(hash >> 7);
+}
+
+#ifdef __SSE2__
+static inline group_mask group_match(const uint8_t *group, uint8_t h2)
+{
+    __m128i ctrl = _mm_loadu_si128((const __m128i *)group);
+    __m128i cmp  = _mm_cmpeq_epi8(ctrl, _mm_set1_epi8((char)h2));
+    return (group_mask)_mm_movemask_epi8(cmp);
+}
+
+static inline group_mask group_match_empty(const uint8_t *group)
+{
+    return group_match(group, CTRL_EMPTY);
+}
+
+static inline group_mask group_match_free(const uint8_t *group)
+{
+    // EMPTY and DELETED are the only control bytes with the high bit set.
+    __m128i ctrl = _mm_loadu_si128((const __m128i *)group);
+    return (group_mask)_mm_movemask_epi8(ctrl);
+}
+#else
+// Scalar fallback, same results just 1 byte at a time.
+static inline group_mask group_match(const uint8_t *group, uint8_t h2)
+{
+    group_mask mask = 0;
+    for (int i = 0; i < GROUP_WIDTH; i++)
+    {
+        if (group[i] == h2) mask |= (group_mask)1 << i;
+    }
+    return mask;
+}
+
+static inline group_mask group_match_empty(const uint8_t *group)
+{
+    return group_match(group, CTRL_EMPTY);
+}
+
+static inline group_mask group_match_free(const uint8_t *group)
+{
+    group_mask mask = 0;
+    for (int i = 0; i < GROUP_WIDTH; i++)
+    {
+        if (group[i] & 0x80) mask |= (group_mask)1 << i;
+    }
+    return mask;
+}
+#endif // __SSE2__
+
+static inline int lowest_bit(group_mask mask)
+{
+    return __builtin_ctz(mask);
+}
+
+/**
+ * @brief Maximum # of used (full or DELETED) slots out of <capacity>.
+ * @note Always keep at least 1/8th of them EMPTY or lookups get slow.
+ */
+static size_t oa_max_load(table *ht, size_t capacity)
+{
+    size_t limit = capacity - capacity / 8;
+    size_t wanted = (size_t)((double)capacity * ht->max_load);
+    return (wanted < limit) ? wanted : limit;
+}
+
+// Where slot <idx>'s inline value lives, if the table has inline values.
+static inline void *oa_value(table *ht, size_t idx)
+{
+    return (ht->values != NULL) ? ht->values + idx * ht->value_size : NULL;
+}
+
+/**
+ * @brief Allocate the control bytes and slots for <capacity> slots.
+ * @note <capacity> must be a power of 2 and a multiple of GROUP_WIDTH.
+ */
+static bool oa_alloc(table *ht, size_t capacity)
+{
+    uint8_t *ctrl = malloc(capacity * sizeof(uint8_t));
+    struct oa_slot *slots = malloc(capacity * sizeof(struct oa_slot));
+    uint8_t *values = NULL;
+    if (ht->value_size != 0) values = malloc(capacity * ht->value_size);
+    if (ctrl == NULL || slots == NULL || (ht->value_size != 0 && values == NULL))
+    {
+        free(ctrl);
+        free(slots);
+        free(values);
+        return false;
+    }
+    memset(ctrl, CTRL_EMPTY, capacity);
+    ht_count(ht, &ht->counters.allocations, (values != NULL) ? 3 : 2);
+
+    ht->ctrl = ctrl;
+    ht->slots = slots;
+    ht->values = values;
+    ht->size = (int)capacity;
+    ht->tombstones = 0;
+    return true;
+}
+
+/**
+ * @brief Find the first EMPTY or DELETED slot along <hash>'s probe sequence.
+ * @note Assumes there is at least one, the load factor guarantees that.
+ */
+static size_t oa_find_free(table *ht, uint64_t hash, bool *collided)
+{
+    size_t group_mask_all = (size_t)ht->size / GROUP_WIDTH - 1;
+    size_t group = oa_h1(hash) & group_mask_all;
+
+    // Triangular steps visit every group once when the group count is 2^n.
+    for (size_t step = 0; ; step++)
+    {
+        const uint8_t *ctrl = ht->ctrl + group * GROUP_WIDTH;
+        group_mask free_slots = group_match_free(ctrl);
+        if (free_slots != 0)
+        {
+            *collided = (step != 0);
+            return group * GROUP_WIDTH + lowest_bit(free_slots);
+        }
+        group = (group + step + 1) & group_mask_all;
+    }
+}
+
+/**
+ * @brief Check the slots of 1 group whose control byte matches <hash>.
+ * @return Index of the slot holding <key>, or -1 if it isn't in this group.
+ */
+static inline long oa_match_group(table *ht, size_t group, const char *key,
+                                  size_t length, uint64_t hash, 
+                                  uint64_t *compares)
+{
+    group_mask matches = group_match(ht->ctrl + group * GROUP_WIDTH, oa_h2(hash));
+    while (matches != 0)
+    {
+        size_t idx = group * GROUP_WIDTH + lowest_bit(matches);
+        struct oa_slot *slot = &ht->slots[idx];
+        // Only compare bytes once both the hash and length agree.
+        if (slot->hash == hash && slot->length == length)
+        {
+            (*compares)++;
+            if (memcmp(slot->key, key, length) == 0) return (long)idx;
+        }
+        // Clear the lowest set bit and try the next candidate.
+        matches &= matches - 1;
+    }
+    return -1;
+}
+
+/**
+ * @brief Find the slot holding <key>.
+ * @param free_idx If not <NULL>, also note the first EMPTY or DELETED slot
+ * along the way, so an insert doesn't need to probe a second time.
+ * @param collided Set to true if that free slot isn't in the home group.
+ * @return Index of the slot, or -1 if <key> is not in the table.
+ */
+static long oa_lookup(table *ht, const char *key, size_t length, 
+                      uint64_t hash, long *free_idx, bool *collided)
+{
+    size_t group_mask_all = (size_t)ht->size / GROUP_WIDTH - 1;
+    size_t group = oa_h1(hash) & group_mask_all;
+    long found = -1;
+    uint64_t probes = 0, compares = 0;
+
+    for (size_t step = 0; step <= group_mask_all; step++)
+    {
+        probes++;
+        found = oa_match_group(ht, group, key, length, hash, &compares);
+        if (found != -1) break;
+
+        const uint8_t *ctrl = ht->ctrl + group * GROUP_WIDTH;
+        if (free_idx != NULL && *free_idx == -1)
+        {
+            group_mask free_slots = group_match_free(ctrl);
+            if (free_slots != 0)
+            {
+                *free_idx = (long)(group * GROUP_WIDTH + lowest_bit(free_slots));
+                *collided = (step != 0);
+            }
+        }
+        // An EMPTY slot means <key> would have been placed here, stop.
+        if (group_match_empty(ctrl) != 0) break;
+
+        group = (group + step + 1) & group_mask_all;
+    }
+    ht_count_lookup(ht, probes, compares);
+    return found;
+}
+
+/**
+ * @brief Move every entry into a new array of <capacity> slots.
+ * @note Also drops all tombstones, so it's used even when we don't grow.
+ * @note Stop-the-world, unlike chained tables: entries can't be split
+ * between 2 probe arrays without every lookup probing both.
+ */
+static bool oa_rehash(table *ht, size_t capacity)
+{
+    uint8_t *old_ctrl = ht->ctrl;
+    struct oa_slot *old_slots = ht->slots;
+    uint8_t *old_values = ht->values;
+    size_t old_capacity = (size_t)ht->size;
+
+    if (!oa_alloc(ht, capacity))
+    {
+        // Leave the table as it was so the caller can still use it.
+        ht->ctrl = old_ctrl;
+        ht->slots = old_slots;
+        ht->values = old_values;
+        return false;
+    }
+
+    for (size_t i = 0; i < old_capacity; i++)
+    {
+        if (old_ctrl[i] & 0x80) continue;
+
+        bool collided;
+        size_t idx = oa_find_free(ht, old_slots[i].hash, &collided);
+        ht->ctrl[idx] = old_ctrl[i];
+        ht->slots[idx] = old_slots[i];
+
+        // Inline values move with their slot, and obj has to follow them.
+        if (old_values != NULL)
+        {
+            ht->slots[idx].obj = oa_value(ht, idx);
+            memcpy(ht->slots[idx].obj, old_slots[i].obj, ht->value_size);
+        }
+    }
+
+    free(old_ctrl);
+    free(old_slots);
+    free(old_values);
+
+    // A new filter for the new size, filled as later calls come in.
+    if (ht->flags & HT_BLOOM) bloom_resize(ht);
+    return true;
+}
+
+bool oa_init(table *ht, int size)
+{
+    // Round up to a power of 2, with room for <size> entries at max load.
+    size_t capacity = GROUP_WIDTH;
+    while (size > 0 && oa_max_load(ht, capacity) < (size_t)size
+           && capacity < HT_MAX_SIZE)
+        capacity *= 2;
+
+    return oa_alloc(ht, capacity);
+}
+
+void oa_destroy(table *ht)
+{
+    for (int i = 0; i < ht->size; i++)
+    {
+        if (ht->ctrl[i] & 0x80) continue;
+
+        ht->clean_fn(ht->slots[i].obj);
+        ht_key_free(ht, ht->slots[i].key);
+    }
+    free(ht->ctrl);
+    free(ht->slots);
+    free(ht->values);
+}
+
+void oa_print(table *ht)
+{
+    int empty_slots = 0;
+    printf("---- START TABLE ----\n");
+    for (int i = 0; i < ht->size; i++)
+    {
+        if (ht->ctrl[i] & 0x80)
+        {
+            empty_slots++;
+            continue;
+        }
+        printf("%4i: %s\n", i, ht->slots[i].key);
+    }
+    printf("We have %zu total collisions and %i empty slots in the table.\n",
+        ht_collisions(ht), empty_slots);
+    printf("---- END TABLE ----\n\n");
+}
+
+void **oa_probe(table *ht, const char *key, size_t length, uint64_t hash,
+                bool insert, bool *inserted)
+{
+    long free_idx = -1;
+    bool collided = false;
+
+    long idx = oa_lookup(ht, key, length, hash, 
+                         insert ? &free_idx : NULL, &collided);
+    if (idx != -1) return &ht->slots[idx].obj;
+    if (!insert) return NULL;
+
+    // Reusing a tombstone is always fine, but EMPTY slots are rationed.
+    size_t capacity = (size_t)ht->size;
+    if (ht->ctrl[free_idx] == CTRL_EMPTY 
+        && ht->count + ht->tombstones >= oa_max_load(ht, capacity))
+    {
+        // Mostly tombstones? Clean them up in place instead of growing.
+        // Can't grow any more and no tombstones to clean? Then we're full.
+        if (ht->count >= oa_max_load(ht, capacity) / 2
+            && capacity < HT_MAX_SIZE)
+            capacity *= 2;
+        else if (ht->count >= oa_max_load(ht, capacity))
+            return NULL;
+        if (!oa_rehash(ht, capacity)) return NULL;
+
+        free_idx = (long)oa_find_free(ht, hash, &collided);
+    }
+
+    char *copy = ht_key_copy(ht, key, length);
+    if (copy == NULL) return NULL;
+
+    if (ht->ctrl[free_idx] == CTRL_DELETED) ht->tombstones--;
+    if (collided) ht->collisions++;
+
+    struct oa_slot *slot = &ht->slots[free_idx];
+    ht->ctrl[free_idx] = oa_h2(hash);
+    slot->key = copy;
+    slot->obj = ht_value_init(ht, oa_value(ht, (size_t)free_idx));
+    slot->hash = hash;
+    slot->length = length;
+    ht->count++;
+
+    *inserted = true;
+    return &slot->obj;
+}
+
+bool oa_delete(table *ht, const char *key, size_t length, uint64_t hash)
+{
+    long idx = oa_lookup(ht, key, length, hash, NULL, NULL);
+    if (idx == -1) return false;
+
+    // If this group still has an EMPTY slot, every probe sequence passing
+    // through it stops here anyway, so we don't need a tombstone.
+    uint8_t *group = ht->ctrl + (idx / GROUP_WIDTH) * GROUP_WIDTH;
+    if (group_match_empty(group) != 0)
+    {
+        ht->ctrl[idx] = CTRL_EMPTY;
+    }
+    else
+    {
+        ht->ctrl[idx] = CTRL_DELETED;
+        ht->tombstones++;
+    }
+
+    ht->clean_fn(ht->slots[idx].obj);
+    ht_key_free(ht, ht->slots[idx].key);
+    ht->count--;
+    return true;
+}
+
+void oa_stats(table *ht, struct ht_stats *stats)
+{
+    size_t group_mask_all = (size_t)ht->size / GROUP_WIDTH - 1;
+    stats->bytes += (size_t)ht->size 
+                    * (sizeof(uint8_t) + sizeof(struct oa_slot) + ht->value_size);
+
+    for (int i = 0; i < ht->size; i++)
+    {
+        if (ht->ctrl[i] & 0x80)
+        {
+            stats->empty_buckets++;
+            continue;
+        }
+        struct oa_slot *slot = &ht->slots[i];
+        if (!(ht->flags & HT_POOLED)) stats->bytes += slot->length + 1;
+
+        // Follow the same probe sequence a lookup would, to this slot's group.
+        size_t target = (size_t)i / GROUP_WIDTH;
+        size_t group = oa_h1(slot->hash) & group_mask_all;
+        size_t probes = 1;
+        for (size_t step = 0; group != target; step++, probes++)
+            group = (group + step + 1) & group_mask_all;
+
+        if (probes > stats->max_chain) stats->max_chain = probes;
+        stats->chains[(probes < HT_STATS_CHAINS) ? probes : HT_STATS_CHAINS - 1]++;
+    }
+}
+
+/**
+ * @brief 1 step of ht_scan: every entry whose home group is <cursor>'s.
+ * @note They can only be along their home group's probe sequence, up to
+ * the first group with an EMPTY slot, or lookups couldn't find them either.
+ * Home groups only split in 2 when we grow, so the cursor still works.
+ */
+uint64_t oa_scan(table *ht, uint64_t cursor, scan_function *fn, void *arg,
+                 size_t *seen)
+{
+    size_t group_mask_all = (size_t)ht->size / GROUP_WIDTH - 1;
+    size_t home = (size_t)cursor & group_mask_all;
+    size_t group = home;
+
+    for (size_t step = 0; step <= group_mask_all; step++)
+    {
+        for (size_t i = 0; i < GROUP_WIDTH; i++)
+        {
+            size_t idx = group * GROUP_WIDTH + i;
+            struct oa_slot *slot = &ht->slots[idx];
+            if ((ht->ctrl[idx] & 0x80) 
+                || (oa_h1(slot->hash) & group_mask_all) != home)
+                continue;
+
+            fn(slot->key, slot->length, slot->obj, arg);
+            (*seen)++;
+        }
+        if (group_match_empty(ht->ctrl + group * GROUP_WIDTH) != 0) break;
+        group = (group + step + 1) & group_mask_all;
+    }
+    return ht_cursor_next(cursor, group_mask_all);
+}
+
+void oa_prefetch(table *ht, uint64_t hash)
+{
+    size_t group = oa_h1(hash) & ((size_t)ht->size / GROUP_WIDTH - 1);
+    __builtin_prefetch(ht->ctrl + group * GROUP_WIDTH);
+}
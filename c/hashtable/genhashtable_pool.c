@@ -0,0 +1,130 @@
+/**
+ * @file genhashtable_pool.c
+ * @brief Slab and arena allocation for HT_POOLED tables.
+ *
+ * Nodes are carved out of big slabs instead of 1 malloc each, and deleted
+ * nodes are kept on a free list for the next insert to reuse.
+ * Keys are bumped into big chunks and never freed one by one, so deleting
+ * a key doesn't give its bytes back until the whole table is destroyed.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "genhashtable_internal.h"
+
+#define FIRST_SLAB_NODES  64        // Slabs double in size up to...
+#define MAX_SLAB_NODES    65536     // ...this many nodes each.
+#define FIRST_CHUNK_BYTES 4096      // Key chunks double in size up to...
+#define MAX_CHUNK_BYTES   (1 << 20) // ...1 MiB each.
+
+/**
+ * @brief malloc a slab with room for <bytes> after its header.
+ * @note The slab is pushed onto <list> so pool_release can find it later.
+ */
+static char *pool_new_slab(struct ht_pool *pool, struct ht_slab **list, 
+                           size_t bytes)
+{
+    struct ht_slab *slab = malloc(sizeof(*slab) + bytes);
+    if (slab == NULL) return NULL;
+
+    pool->slabs++;
+    pool->bytes += sizeof(*slab) + bytes;
+    slab->next = *list;
+    *list = slab;
+    return (char *)(slab + 1);
+}
+
+void pool_init(struct ht_pool *pool, size_t node_size)
+{
+    pool->node_slabs = NULL;
+    pool->key_chunks = NULL;
+    pool->free_nodes = NULL;
+    pool->node_next = pool->node_end = NULL;
+    pool->key_next = pool->key_end = NULL;
+
+    // Free nodes are linked through their first pointer, so round up.
+    size_t align = sizeof(void *);
+    pool->node_size = (node_size + align - 1) / align * align;
+    pool->slab_nodes = FIRST_SLAB_NODES;
+    pool->chunk_bytes = FIRST_CHUNK_BYTES;
+    pool->slabs = 0;
+    pool->bytes = 0;
+}
+
+void *pool_node_alloc(struct ht_pool *pool)
+{
+    // Recycle a deleted node first, it's probably still in cache.
+    if (pool->free_nodes != NULL)
+    {
+        void *node = pool->free_nodes;
+        pool->free_nodes = *(void **)node;
+        return node;
+    }
+
+    if (pool->node_next == pool->node_end)
+    {
+        size_t bytes = pool->slab_nodes * pool->node_size;
+        char *start = pool_new_slab(pool, &pool->node_slabs, bytes);
+        if (start == NULL) return NULL;
+
+        pool->node_next = start;
+        pool->node_end = start + bytes;
+        if (pool->slab_nodes < MAX_SLAB_NODES) pool->slab_nodes *= 2;
+    }
+
+    void *node = pool->node_next;
+    pool->node_next += pool->node_size;
+    return node;
+}
+
+void *pool_node_bulk(struct ht_pool *pool, size_t count)
+{
+    // A slab of its own, the one we're carving from stays as it is.
+    return pool_new_slab(pool, &pool->node_slabs, count * pool->node_size);
+}
+
+void pool_node_free(struct ht_pool *pool, void *node)
+{
+    *(void **)node = pool->free_nodes;
+    pool->free_nodes = node;
+}
+
+char *pool_key_alloc(struct ht_pool *pool, size_t bytes)
+{
+    if ((size_t)(pool->key_end - pool->key_next) < bytes)
+    {
+        // Oversized keys get a chunk of their own, the rest share.
+        size_t chunk = pool->chunk_bytes;
+        if (chunk < bytes) chunk = bytes;
+
+        char *start = pool_new_slab(pool, &pool->key_chunks, chunk);
+        if (start == NULL) return NULL;
+
+        pool->key_next = start;
+        pool->key_end = start + chunk;
+        if (pool->chunk_bytes < MAX_CHUNK_BYTES) pool->chunk_bytes *= 2;
+    }
+
+    char *key = pool->key_next;
+    pool->key_next += bytes;
+    return key;
+}
+
+void pool_release(struct ht_pool *pool)
+{
+    struct ht_slab *lists[] = {pool->node_slabs, pool->key_chunks};
+    for (size_t i = 0; i < sizeof(lists) / sizeof(lists[0]); i++)
+    {
+        struct ht_slab *slab = lists[i];
+        while (slab != NULL)
+        {
+            struct ht_slab *next = slab->next;
+            free(slab);
+            slab = next;
+        }
+    }
+    pool_init(pool, pool->node_size);
+}
@@ -0,0 +1,106 @@
+/**
+ * @file genhashtable_stats.c
+ * @brief ht_stats, a look at how well a table is actually doing.
+ *
+ * Walks every linked list (or asks the backend to walk its slots), so it
+ * sees what lookups see: how long the chains got, how much is empty, and
+ * roughly how much memory it all takes.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "genhashtable_internal.h"
+
+void ht_stats_chain(struct ht_stats *stats, size_t length)
+{
+    if (length == 0) stats->empty_buckets++;
+    if (length > stats->max_chain) stats->max_chain = length;
+
+    size_t bucket = (length < HT_STATS_CHAINS) ? length : HT_STATS_CHAINS - 1;
+    stats->chains[bucket]++;
+}
+
+/**
+ * @brief Add <size> linked lists to <stats>, with their nodes and keys.
+ * @note Loads are atomic so HT_CONCURRENT writers can keep going.
+ */
+static void stats_lists(table *ht, sllnode **elements, int size,
+                        struct ht_stats *stats)
+{
+    bool pooled = (ht->flags & HT_POOLED) != 0;
+    stats->bytes += (size_t)size * sizeof(sllnode *);
+
+    for (int i = 0; i < size; i++)
+    {
+        size_t length = 0;
+        sllnode *tmp = __atomic_load_n(&elements[i], __ATOMIC_ACQUIRE);
+        while (tmp != NULL)
+        {
+            length++;
+            // Pooled nodes and keys are counted a whole slab at a time.
+            if (!pooled) 
+                stats->bytes += ht_node_bytes(ht) + ht->value_size
+                                + tmp->length + 1;
+            tmp = __atomic_load_n(&tmp->next, __ATOMIC_ACQUIRE);
+        }
+        ht_stats_chain(stats, length);
+    }
+}
+
+bool ht_stats(table *ht, struct ht_stats *stats)
+{
+    if (ht == NULL || stats == NULL) return false;
+
+    memset(stats, 0, sizeof(*stats));
+    stats->bytes = sizeof(*ht) + ht->pool.bytes;
+
+    if (ht->flags & HT_MAPPED)
+    {
+        map_stats(ht, stats);
+    }
+    else if (ht->flags & HT_OPEN_ADDRESSING)
+    {
+        oa_stats(ht, stats);
+    }
+    else
+    {
+        // Readers pin themselves, so nothing we walk gets freed under us.
+        ht_pin(ht);
+        stats_lists(ht, ht->elements, ht->size, stats);
+        if (ht_rehashing(ht))
+        {
+            // Moved lists are empty now, they'd make the histogram lie.
+            stats_lists(ht, ht->old_elements + ht->rehash_idx,
+                        ht->old_size - (int)ht->rehash_idx, stats);
+            stats->bytes += ht->rehash_idx * sizeof(sllnode *);
+        }
+        ht_unpin(ht);
+        if (ht->flags & HT_CONCURRENT) stats->bytes += cc_bytes(ht);
+    }
+
+    // Mid-resize, everything ends up in the new array, so that's the size.
+    stats->count = __atomic_load_n(&ht->count, __ATOMIC_RELAXED);
+    stats->buckets = (size_t)ht->size;
+    stats->load_factor = (stats->buckets != 0)
+        ? (double)stats->count / (double)stats->buckets : 0.0;
+
+    if (ht->flags & HT_COUNTERS)
+    {
+        stats->lookups = __atomic_load_n(&ht->counters.lookups, __ATOMIC_RELAXED);
+        stats->probes = __atomic_load_n(&ht->counters.probes, __ATOMIC_RELAXED);
+        stats->compares = __atomic_load_n(&ht->counters.compares, __ATOMIC_RELAXED);
+        stats->allocations = ht->pool.slabs
+            + __atomic_load_n(&ht->counters.allocations, __ATOMIC_RELAXED);
+    }
+    if (ht->flags & HT_BLOOM) bloom_stats(ht, stats);
+    if (ht->flags & HT_CACHE)
+    {
+        stats->hits = ht->cache.hits;
+        stats->misses = ht->cache.misses;
+        stats->evictions = ht->cache.evictions;
+    }
+    return true;
+}
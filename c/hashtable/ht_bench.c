@@ -0,0 +1,907 @@
+/**
+ * @file ht_bench.c
+ * @brief Rough benchmarks for the generic hashtable's backends.
+ * Usage: ./ht_bench [#keys] [#threads]
+ * @note Build with optimizations on, see the Makefile.
+ */
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "genhashtable.h"
+#include "typed_hashtable.h"
+
+#define KEY_LENGTH 24
+
+DEFINE_HASHTABLE(u64map, uint64_t, uint64_t, th_hash_u64, th_eq)
+
+// FNV-1a, nothing fancy, but the same for every backend we compare.
+static uint64_t bench_hash(const char *key, size_t length)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < length; i++)
+    {
+        hash ^= (unsigned char)key[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+// Objects are never looked at, so there's nothing to free either.
+static void bench_noclean(void *obj)
+{
+    (void)obj;
+}
+
+static double now_seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * @brief Make <n> NUL terminated keys, each <KEY_LENGTH> bytes apart.
+ * @note <prefix> lets us make a second set of keys that never hit.
+ */
+static char *make_keys(size_t n, const char *prefix)
+{
+    char *keys = malloc(n * KEY_LENGTH);
+    if (keys == NULL) return NULL;
+
+    for (size_t i = 0; i < n; i++)
+        snprintf(&keys[i * KEY_LENGTH], KEY_LENGTH, "%s%zu", prefix, i);
+    return keys;
+}
+
+// Fisher-Yates on an index array, so lookups don't follow insert order.
+static size_t *make_order(size_t n)
+{
+    size_t *order = malloc(n * sizeof(size_t));
+    if (order == NULL) return NULL;
+
+    for (size_t i = 0; i < n; i++) order[i] = i;
+    for (size_t i = n - 1; i > 0; i--)
+    {
+        size_t j = (size_t)rand() % (i + 1);
+        size_t tmp = order[i];
+        order[i] = order[j];
+        order[j] = tmp;
+    }
+    return order;
+}
+
+/**
+ * @brief Insert <n> keys, then look up <n> keys of which <hit_percent> exist.
+ * @return Nanoseconds per lookup.
+ */
+static double bench_lookups(table *ht, const char *hits, const char *misses,
+                            const size_t *order, size_t n, int hit_percent)
+{
+    size_t found = 0;
+    double start = now_seconds();
+    for (size_t i = 0; i < n; i++)
+    {
+        size_t k = order[i];
+        const char *key = ((int)(k % 100) < hit_percent)
+            ? &hits[k * KEY_LENGTH]
+            : &misses[k * KEY_LENGTH];
+        if (ht_find(ht, key) != NULL) found++;
+    }
+    double elapsed = now_seconds() - start;
+
+    // Print <found> so the compiler can't throw the lookups away.
+    printf("    %3i%% hits: %7.1f ns/find (%zu found)\n",
+        hit_percent, elapsed * 1e9 / n, found);
+    return elapsed * 1e9 / n;
+}
+
+// Count what ht_scan hands us, so the compiler can't skip the walk.
+static void bench_scan_count(const char *key, size_t length, void *obj,
+                             void *arg)
+{
+    (void)key;
+    (void)obj;
+    *(size_t *)arg += length;
+}
+
+// Walk every entry with ht_iter_next, then with ht_scan 1000 at a time.
+static void bench_walk(table *ht, size_t n)
+{
+    size_t bytes = 0, length;
+    ht_iter it;
+    double start = now_seconds();
+    ht_iter_begin(ht, &it);
+    while (ht_iter_next(&it, NULL, &length, NULL)) bytes += length;
+    double iter = now_seconds() - start;
+
+    uint64_t cursor = 0;
+    start = now_seconds();
+    do
+    {
+        cursor = ht_scan(ht, cursor, 1000, bench_scan_count, &bytes);
+    } while (cursor != 0);
+    double scan = now_seconds() - start;
+
+    printf("    walk:      %7.1f ns/entry iter, %7.1f ns/entry scan (%zu)\n",
+        iter * 1e9 / n, scan * 1e9 / n, bytes);
+}
+
+static void bench_backend(const char *name, unsigned flags,
+                          const char *hits, const char *misses,
+                          const size_t *order, size_t n)
+{
+    table *ht = ht_create((int)n, bench_hash, bench_noclean, flags);
+    if (ht == NULL) return;
+
+    double start = now_seconds();
+    for (size_t i = 0; i < n; i++)
+        ht_insert(ht, &hits[i * KEY_LENGTH], (void *)&hits[i * KEY_LENGTH]);
+    double elapsed = now_seconds() - start;
+
+    struct ht_stats stats;
+    ht_stats(ht, &stats);
+    printf("%s (%zu collisions)\n", name, ht_collisions(ht));
+    printf("    inserts:   %7.1f ns/insert, %.1f MiB, load %.2f\n", 
+        elapsed * 1e9 / n, stats.bytes / 1048576.0, stats.load_factor);
+    bench_lookups(ht, hits, misses, order, n, 100);
+    bench_lookups(ht, hits, misses, order, n, 90);
+    bench_lookups(ht, hits, misses, order, n, 10);
+    bench_lookups(ht, hits, misses, order, n, 0);
+    bench_walk(ht, n);
+    if (flags & HT_BLOOM)
+    {
+        ht_stats(ht, &stats);
+        printf("    bloom:     %llu misses filtered, %.3f%% false positives\n",
+            (unsigned long long)stats.filtered,
+            stats.false_positive_rate * 100.0);
+    }
+
+    start = now_seconds();
+    ht_destroy(ht);
+    elapsed = now_seconds() - start;
+    printf("    destroy:   %7.1f ms\n", elapsed * 1e3);
+}
+
+// Key i is deleted again while growing if i is even and 2i < n, see below.
+static bool bench_grow_deleted(size_t k, size_t n)
+{
+    return k % 2 == 0 && 2 * k < n;
+}
+
+/**
+ * @brief Start at 8 buckets and grow through every doubling up to <n> keys,
+ * deleting some of them along the way, so deletes land mid-migration too.
+ * Then check every key is still there (or gone) and the count adds up.
+ * @note Also the slowest single insert. Chained tables spread each resize
+ * over later calls, so theirs should stay small. Open addressing tables
+ * move every slot inside the insert that grows them, so theirs is the cost
+ * of rehashing the whole table, and it's printed as such.
+ */
+static void bench_grow_backend(const char *name, unsigned flags,
+                               double max_load, const char *hits, size_t n)
+{
+    table *ht = ht_create(8, bench_hash, bench_noclean, flags);
+    if (ht == NULL) return;
+    if (max_load > 0) ht_set_max_load(ht, max_load);
+
+    size_t deleted = 0, wrong = 0;
+    double worst = 0;
+    double start = now_seconds();
+    for (size_t i = 0; i < n; i++)
+    {
+        const char *key = &hits[i * KEY_LENGTH];
+        double before = now_seconds();
+        if (!ht_insert(ht, key, (void *)key)) wrong++;
+        double took = now_seconds() - before;
+        if (took > worst) worst = took;
+
+        // Every 4th insert also deletes key i / 2, which is even and < n / 2.
+        if (i % 4 == 0)
+        {
+            if (ht_delete(ht, &hits[i / 2 * KEY_LENGTH])) deleted++;
+            else wrong++;
+        }
+    }
+    double elapsed = now_seconds() - start;
+
+    for (size_t k = 0; k < n; k++)
+    {
+        const char *key = &hits[k * KEY_LENGTH];
+        void *obj = ht_find(ht, key);
+        if (bench_grow_deleted(k, n) ? obj != NULL : obj != key) wrong++;
+    }
+
+    struct ht_stats stats;
+    ht_stats(ht, &stats);
+    if (stats.count != n - deleted) wrong++;
+    printf("    %-28s %7.1f ns/op, slowest insert %6.1f us%s, "
+           "%zu buckets%s\n", name, elapsed * 1e9 / (n + deleted), worst * 1e6,
+           (flags & HT_OPEN_ADDRESSING) ? " (full rehash)" : "",
+           stats.buckets, (wrong != 0) ? "  (lost some!)" : "");
+
+    // Empty it out again, every delete must find its key.
+    for (size_t k = 0; k < n; k++)
+    {
+        if (bench_grow_deleted(k, n)) continue;
+        if (!ht_delete(ht, &hits[k * KEY_LENGTH])) wrong++;
+    }
+    ht_stats(ht, &stats);
+    if (wrong != 0 || stats.count != 0)
+        printf("    %-28s %zu keys wrong, %zu left after deleting all\n",
+               name, wrong, stats.count);
+    ht_destroy(ht);
+}
+
+static void bench_grow(const char *hits, size_t n)
+{
+    printf("growing from 8 buckets\n");
+    bench_grow_backend("chained:", HT_CHAINED, 0, hits, n);
+    bench_grow_backend("chained, max load 4:", HT_CHAINED, 4.0, hits, n);
+    bench_grow_backend("chained, pooled:", HT_CHAINED | HT_POOLED, 0, hits, n);
+    bench_grow_backend("chained, bloom:", HT_CHAINED | HT_BLOOM, 0, hits, n);
+    bench_grow_backend("open addressing:", HT_OPEN_ADDRESSING, 0, hits, n);
+}
+
+/**
+ * @brief Time <hf> on its own, then in a chained table.
+ * @note Fewer collisions means shorter chains to walk on every find.
+ */
+static void bench_hash_fn(const char *name, hash_function *hf,
+                          const char *hits, const char *misses,
+                          const size_t *order, size_t n)
+{
+    uint64_t sum = 0;
+    double start = now_seconds();
+    for (size_t i = 0; i < n; i++)
+    {
+        const char *key = &hits[i * KEY_LENGTH];
+        sum += hf(key, strlen(key));
+    }
+    double elapsed = now_seconds() - start;
+
+    table *ht = ht_create((int)n, hf, bench_noclean, HT_CHAINED | HT_COUNTERS);
+    if (ht == NULL) return;
+    for (size_t i = 0; i < n; i++)
+        ht_insert(ht, &hits[i * KEY_LENGTH], (void *)&hits[i * KEY_LENGTH]);
+
+    // Print <sum> so the compiler can't throw the hashing away.
+    printf("%s (%zu collisions)\n", name, ht_collisions(ht));
+    printf("    hashing:   %7.1f ns/key (sum %016llx)\n", 
+        elapsed * 1e9 / n, (unsigned long long)sum);
+
+    // Only count the lookups, not the inserts before them.
+    struct ht_stats before, after;
+    ht_stats(ht, &before);
+    bench_lookups(ht, hits, misses, order, n, 100);
+    ht_stats(ht, &after);
+
+    uint64_t lookups = after.lookups - before.lookups;
+    printf("    chains:    %zu empty, longest %zu, %.2f nodes/find, %.2f compares/find\n",
+        after.empty_buckets, after.max_chain,
+        (double)(after.probes - before.probes) / (double)lookups,
+        (double)(after.compares - before.compares) / (double)lookups);
+    ht_destroy(ht);
+}
+
+static void bench_hashes(const char *hits, const char *misses,
+                         const size_t *order, size_t n)
+{
+    bench_hash_fn("hash: FNV-1a", bench_hash, hits, misses, order, n);
+    bench_hash_fn("hash: ht_hash_wyhash", ht_hash_wyhash, 
+                  hits, misses, order, n);
+    bench_hash_fn("hash: ht_hash_fast", ht_hash_fast, hits, misses, order, n);
+    bench_hash_fn("hash: ht_hash_seeded", ht_hash_seeded, 
+                  hits, misses, order, n);
+}
+
+// Every obj in the benchmarks is its own key, so save that.
+static size_t bench_serialize(const void *obj, void *buf, size_t size)
+{
+    size_t length = strlen(obj) + 1;
+    if (length <= size) memcpy(buf, obj, length);
+    return length;
+}
+
+/**
+ * @brief Rebuilding a table with ht_insert vs. mapping a saved one.
+ * @note The file was just written, so it's in the page cache. A real cold
+ * start also pays for reading each touched page from disk.
+ */
+static void bench_snapshot(const char *hits, const char *misses,
+                           const size_t *order, size_t n)
+{
+    const char *path = "./ht_bench.snapshot";
+    double start = now_seconds();
+    table *ht = ht_create((int)n, bench_hash, bench_noclean, HT_CHAINED);
+    if (ht == NULL) return;
+    for (size_t i = 0; i < n; i++)
+        ht_insert(ht, &hits[i * KEY_LENGTH], (void *)&hits[i * KEY_LENGTH]);
+    double rebuild = now_seconds() - start;
+
+    start = now_seconds();
+    bool saved = ht_save(ht, path, bench_serialize);
+    double save = now_seconds() - start;
+    ht_destroy(ht);
+    if (!saved) return;
+
+    start = now_seconds();
+    table *mapped = ht_open_mmap(path);
+    double open = now_seconds() - start;
+    if (mapped != NULL)
+    {
+        printf("snapshot\n");
+        printf("    rebuild:   %7.1f ms\n", rebuild * 1e3);
+        printf("    ht_save:   %7.1f ms\n", save * 1e3);
+        printf("    open:      %7.3f ms\n", open * 1e3);
+        bench_lookups(mapped, hits, misses, order, n, 100);
+        bench_lookups(mapped, hits, misses, order, n, 0);
+        ht_destroy(mapped);
+    }
+    remove(path);
+}
+
+#define FIND_BATCH 256
+
+/**
+ * @brief Look up every key in <lookups> 1 by 1, then FIND_BATCH at a time.
+ * @note Only interesting once the table is much bigger than your LLC.
+ */
+static void bench_batch_backend(const char *name, unsigned flags,
+                                const char *hits, const char **lookups,
+                                size_t n)
+{
+    table *ht = ht_create((int)n, bench_hash, bench_noclean, flags);
+    void **out = malloc(n * sizeof(void *));
+    if (ht == NULL || out == NULL)
+    {
+        ht_destroy(ht);
+        free(out);
+        return;
+    }
+
+    // Build it with ht_insert_batch too, the objs are just the keys.
+    const char **keys = malloc(n * sizeof(char *));
+    if (keys == NULL)
+    {
+        ht_destroy(ht);
+        free(out);
+        return;
+    }
+    for (size_t i = 0; i < n; i++) keys[i] = &hits[i * KEY_LENGTH];
+    ht_insert_batch(ht, keys, (void **)keys, n, NULL);
+    free(keys);
+
+    size_t found = 0;
+    double start = now_seconds();
+    for (size_t i = 0; i < n; i++)
+    {
+        if (ht_find(ht, lookups[i]) != NULL) found++;
+    }
+    double single = now_seconds() - start;
+
+    size_t found_batch = 0;
+    start = now_seconds();
+    for (size_t i = 0; i < n; i += FIND_BATCH)
+    {
+        size_t count = (n - i < FIND_BATCH) ? n - i : FIND_BATCH;
+        found_batch += ht_find_batch(ht, &lookups[i], count, &out[i]);
+    }
+    double batch = now_seconds() - start;
+
+    printf("%s\n", name);
+    printf("    1 by 1:    %7.1f ns/find (%zu found)\n", single * 1e9 / n, found);
+    printf("    batched:   %7.1f ns/find (%zu found)\n", batch * 1e9 / n, found_batch);
+    free(out);
+    ht_destroy(ht);
+}
+
+static void bench_batch(const char *hits, const char *misses,
+                        const size_t *order, size_t n)
+{
+    const char **lookups = malloc(n * sizeof(char *));
+    if (lookups == NULL) return;
+
+    // 90% hits, in random order so every lookup is a fresh cache miss.
+    for (size_t i = 0; i < n; i++)
+    {
+        size_t k = order[i];
+        lookups[i] = (k % 10 != 0) ? &hits[k * KEY_LENGTH] : &misses[k * KEY_LENGTH];
+    }
+    bench_batch_backend("chained, batched", HT_CHAINED, hits, lookups, n);
+    bench_batch_backend("open addressing, batched", HT_OPEN_ADDRESSING, 
+                        hits, lookups, n);
+    free(lookups);
+}
+
+static size_t hash_calls = 0;
+static size_t cleaned = 0;
+
+// bench_hash, but counts how often it's called.
+static uint64_t bench_counting_hash(const char *key, size_t length)
+{
+    hash_calls++;
+    return bench_hash(key, length);
+}
+
+// free, but counts how many objects the table gave back.
+static void bench_counting_free(void *obj)
+{
+    cleaned++;
+    free(obj);
+}
+
+/**
+ * @brief Count <n> records over <n> / 8 keys into <ht>, 1 counter per key.
+ * @param single Use ht_find_or_insert and bump the counter through its slot,
+ * else ht_find, then ht_insert a new counter if there was none.
+ * @return false if we ran out of memory.
+ */
+static bool bench_count_records(table *ht, const char **records, size_t n,
+                                bool single)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        if (single)
+        {
+            bool inserted;
+            void **slot = ht_find_or_insert(ht, records[i], &inserted);
+            if (slot == NULL) return false;
+            if (inserted)
+            {
+                *slot = calloc(1, sizeof(size_t));
+                if (*slot == NULL) return false;
+            }
+            (*(size_t *)*slot)++;
+            continue;
+        }
+
+        size_t *counter = ht_find(ht, records[i]);
+        if (counter == NULL)
+        {
+            counter = calloc(1, sizeof(size_t));
+            if (counter == NULL || !ht_insert(ht, records[i], counter))
+                return false;
+        }
+        (*counter)++;
+    }
+    return true;
+}
+
+/**
+ * @brief The aggregation case ht_find_or_insert is for: ht_find + ht_insert
+ * vs. 1 ht_find_or_insert per record, hashes and list walks per record.
+ * Then ht_upsert and ht_replace, checking which objects get cleaned up.
+ */
+static void bench_upsert_backend(const char *name, unsigned flags,
+                                 const char **records, const char *hits,
+                                 size_t n, size_t distinct)
+{
+    table *tables[2];
+    double times[2];
+    size_t hashes[2];
+    uint64_t lookups[2];
+    bool ok = true;
+    for (int single = 0; single < 2; single++)
+    {
+        tables[single] = ht_create((int)distinct, bench_counting_hash,
+                                   bench_counting_free, flags | HT_COUNTERS);
+        if (tables[single] == NULL)
+        {
+            ht_destroy(tables[0]);
+            return;
+        }
+
+        hash_calls = 0;
+        double start = now_seconds();
+        if (!bench_count_records(tables[single], records, n, single))
+            ok = false;
+        times[single] = now_seconds() - start;
+        hashes[single] = hash_calls;
+
+        struct ht_stats stats;
+        ht_stats(tables[single], &stats);
+        lookups[single] = stats.lookups;
+    }
+
+    // Both ways must come up with the same count for every key.
+    size_t total = 0;
+    for (size_t k = 0; k < distinct; k++)
+    {
+        size_t *a = ht_find(tables[0], &hits[k * KEY_LENGTH]);
+        size_t *b = ht_find(tables[1], &hits[k * KEY_LENGTH]);
+        if (a == NULL || b == NULL || *a != *b) ok = false;
+        else total += *b;
+    }
+    if (total != n) ok = false;
+
+    // Every replaced obj is cleaned up once, unless it's the same obj again.
+    // ht_replace on a missing key leaves both the table and obj alone.
+    table *ht = tables[1];
+    const char *key = &hits[0];
+    const char *missing = &hits[distinct * KEY_LENGTH];
+    size_t *fresh = calloc(1, sizeof(size_t));
+    size_t *again = calloc(1, sizeof(size_t));
+    cleaned = 0;
+    if (fresh == NULL || again == NULL)
+    {
+        free(fresh);
+        free(again);
+        ok = false;
+    }
+    else
+    {
+        if (ht_replace(ht, missing, fresh) != NULL || ht_find(ht, missing)
+            || cleaned != 0)
+            ok = false;
+        void **slot = ht_upsert(ht, key, fresh);
+        if (slot == NULL || *slot != fresh || cleaned != 1) ok = false;
+        if (ht_upsert(ht, key, fresh) == NULL || cleaned != 1) ok = false;
+        slot = ht_replace(ht, key, again);
+        if (slot == NULL || *slot != again || ht_find(ht, key) != again
+            || cleaned != 2)
+            ok = false;
+        if (!ht_delete(ht, key) || cleaned != 3 || ht_find(ht, key) != NULL)
+            ok = false;
+    }
+
+    printf("%s\n", name);
+    printf("    find+insert:    %6.1f ns/record, %.2f hashes, %.2f walks\n",
+        times[0] * 1e9 / n, (double)hashes[0] / n, (double)lookups[0] / n);
+    printf("    find_or_insert: %6.1f ns/record, %.2f hashes, %.2f walks%s\n",
+        times[1] * 1e9 / n, (double)hashes[1] / n, (double)lookups[1] / n,
+        (ok) ? "" : "  (wrong counts or cleanup!)");
+    ht_destroy(tables[0]);
+    ht_destroy(tables[1]);
+}
+
+static void bench_upsert(const char *hits, const size_t *order, size_t n)
+{
+    // 8 records per key on average, in random order.
+    size_t distinct = (n / 8 > 0) ? n / 8 : 1;
+    if (distinct >= n) return;
+    const char **records = malloc(n * sizeof(char *));
+    if (records == NULL) return;
+    for (size_t i = 0; i < n; i++)
+        records[i] = &hits[(order[i] % distinct) * KEY_LENGTH];
+
+    printf("counting %zu records over %zu keys\n", n, distinct);
+    bench_upsert_backend("chained", HT_CHAINED, records, hits, n, distinct);
+    bench_upsert_backend("open addressing", HT_OPEN_ADDRESSING, 
+                         records, hits, n, distinct);
+    free(records);
+}
+
+/**
+ * @brief 1 ht_insert per key vs. ht_build_parallel on 1, 2, 4... threads.
+ * @note Load time is what matters here, lookups are the same either way.
+ */
+static void bench_build(const char *hits, size_t n, int max_threads)
+{
+    const char **keys = malloc(n * sizeof(char *));
+    if (keys == NULL) return;
+    for (size_t i = 0; i < n; i++) keys[i] = &hits[i * KEY_LENGTH];
+
+    double start = now_seconds();
+    table *ht = ht_create((int)n, bench_hash, bench_noclean, HT_CHAINED);
+    for (size_t i = 0; ht != NULL && i < n; i++)
+        ht_insert(ht, keys[i], (void *)keys[i]);
+    double elapsed = now_seconds() - start;
+    ht_destroy(ht);
+
+    printf("build\n");
+    printf("    ht_insert:   %7.1f ms\n", elapsed * 1e3);
+    for (int nthreads = 1; nthreads <= max_threads; nthreads *= 2)
+    {
+        double times[2];
+        unsigned flags[2] = {HT_CHAINED, HT_CHAINED | HT_UNIQUE_KEYS};
+        for (int f = 0; f < 2; f++)
+        {
+            start = now_seconds();
+            ht = ht_build_parallel(keys, (void **)keys, n, nthreads, bench_hash,
+                                   bench_noclean, flags[f], NULL);
+            times[f] = now_seconds() - start;
+            ht_destroy(ht);
+        }
+        printf("    %3i threads: %7.1f ms, %7.1f ms with HT_UNIQUE_KEYS\n",
+            nthreads, times[0] * 1e3, times[1] * 1e3);
+    }
+    free(keys);
+}
+
+/**
+ * @brief uint64_t keys: ht_find_n on their 8 bytes vs. a DEFINE_HASHTABLE map.
+ * @note Both look up the same keys in the same random order.
+ */
+static void bench_typed(const size_t *order, size_t n)
+{
+    uint64_t *keys = malloc(n * sizeof(uint64_t));
+    if (keys == NULL) return;
+    for (size_t i = 0; i < n; i++) keys[i] = (uint64_t)i * 0x9E3779B97F4A7C15ULL;
+
+    table *ht = ht_create((int)n, NULL, bench_noclean, HT_OPEN_ADDRESSING);
+    u64map map;
+    if (ht == NULL || !u64map_init(&map, n))
+    {
+        ht_destroy(ht);
+        free(keys);
+        return;
+    }
+
+    double start = now_seconds();
+    for (size_t i = 0; i < n; i++)
+        ht_insert_n(ht, (const char *)&keys[i], sizeof(uint64_t), &keys[i]);
+    double ht_inserts = now_seconds() - start;
+
+    start = now_seconds();
+    for (size_t i = 0; i < n; i++) u64map_insert(&map, keys[i], keys[i]);
+    double map_inserts = now_seconds() - start;
+
+    uint64_t sum = 0;
+    start = now_seconds();
+    for (size_t i = 0; i < n; i++)
+    {
+        uint64_t *val = ht_find_n(ht, (const char *)&keys[order[i]], sizeof(uint64_t));
+        if (val != NULL) sum += *val;
+    }
+    double ht_finds = now_seconds() - start;
+
+    uint64_t map_sum = 0;
+    start = now_seconds();
+    for (size_t i = 0; i < n; i++)
+    {
+        uint64_t *val = u64map_find(&map, keys[order[i]]);
+        if (val != NULL) map_sum += *val;
+    }
+    double map_finds = now_seconds() - start;
+
+    // Print the sums so the compiler can't throw the lookups away.
+    printf("uint64_t keys\n");
+    printf("    ht_find_n:   %7.1f ns/insert, %7.1f ns/find (sum %llx)\n",
+        ht_inserts * 1e9 / n, ht_finds * 1e9 / n, (unsigned long long)sum);
+    printf("    u64map_find: %7.1f ns/insert, %7.1f ns/find (sum %llx)\n",
+        map_inserts * 1e9 / n, map_finds * 1e9 / n, (unsigned long long)map_sum);
+
+    ht_destroy(ht);
+    u64map_destroy(&map);
+    free(keys);
+}
+
+/**
+ * @brief 8 byte counters: 1 malloc'd obj per entry vs. ht_create_sized.
+ * @note ht_stats can't see the malloc'd objs, so they're added in by hand.
+ */
+static void bench_inline_backend(const char *name, unsigned flags, bool sized,
+                                 const char *hits, const size_t *order, size_t n)
+{
+    table *ht = sized 
+        ? ht_create_sized((int)n, sizeof(uint64_t), bench_hash, NULL, flags)
+        : ht_create((int)n, bench_hash, NULL, flags);
+    if (ht == NULL) return;
+
+    double start = now_seconds();
+    for (size_t i = 0; i < n; i++)
+    {
+        uint64_t count = i;
+        if (sized)
+        {
+            ht_insert(ht, &hits[i * KEY_LENGTH], &count);
+            continue;
+        }
+        uint64_t *obj = malloc(sizeof(uint64_t));
+        if (obj == NULL) break;
+        *obj = count;
+        if (!ht_insert(ht, &hits[i * KEY_LENGTH], obj)) free(obj);
+    }
+    double inserts = now_seconds() - start;
+
+    uint64_t sum = 0;
+    start = now_seconds();
+    for (size_t i = 0; i < n; i++)
+    {
+        uint64_t *count = ht_find(ht, &hits[order[i] * KEY_LENGTH]);
+        if (count != NULL) sum += *count;
+    }
+    double finds = now_seconds() - start;
+
+    // glibc's smallest chunk is 32 bytes, whatever we ask for.
+    struct ht_stats stats;
+    ht_stats(ht, &stats);
+    size_t bytes = stats.bytes + (sized ? 0 : n * 32);
+
+    printf("%s\n", name);
+    printf("    %7.1f ns/insert, %7.1f ns/find, %.1f MiB (sum %llu)\n",
+        inserts * 1e9 / n, finds * 1e9 / n, bytes / 1048576.0, 
+        (unsigned long long)sum);
+    ht_destroy(ht);
+}
+
+static void bench_inline(const char *hits, const size_t *order, size_t n)
+{
+    bench_inline_backend("counters, chained, malloc'd", HT_CHAINED, false,
+                         hits, order, n);
+    bench_inline_backend("counters, chained, inline", HT_CHAINED, true,
+                         hits, order, n);
+    bench_inline_backend("counters, open addressing, malloc'd", 
+                         HT_OPEN_ADDRESSING, false, hits, order, n);
+    bench_inline_backend("counters, open addressing, inline", 
+                         HT_OPEN_ADDRESSING, true, hits, order, n);
+}
+
+/**
+ * @brief Memoize with a HT_CACHE table 1/10th the size of the key set:
+ * find, and insert on a miss. Popular keys are asked for far more often.
+ */
+static void bench_cache_policy(const char *name, unsigned policy,
+                               const char *hits, const size_t *wanted, size_t n)
+{
+    table *ht = ht_create((int)(n / 10), bench_hash, bench_noclean, HT_CACHE);
+    if (ht == NULL) return;
+    ht_set_cache(ht, n / 10, 0, policy, NULL);
+
+    double start = now_seconds();
+    for (size_t i = 0; i < n; i++)
+    {
+        const char *key = &hits[wanted[i] * KEY_LENGTH];
+        if (ht_find(ht, key) == NULL) ht_insert(ht, key, (void *)key);
+    }
+    double elapsed = now_seconds() - start;
+
+    struct ht_stats stats;
+    ht_stats(ht, &stats);
+    printf("%s\n", name);
+    printf("    %7.1f ns/access, %5.1f%% hits, %llu evictions\n",
+        elapsed * 1e9 / n, 100.0 * stats.hits / (stats.hits + stats.misses),
+        (unsigned long long)stats.evictions);
+    ht_destroy(ht);
+}
+
+static void bench_cache(const char *hits, size_t n)
+{
+    size_t *wanted = malloc(n * sizeof(size_t));
+    if (wanted == NULL) return;
+
+    // Squaring a uniform pick skews it towards the low keys.
+    for (size_t i = 0; i < n; i++)
+    {
+        double r = (double)rand() / ((double)RAND_MAX + 1.0);
+        wanted[i] = (size_t)(r * r * (double)n);
+    }
+    bench_cache_policy("cache, LRU", HT_EVICT_LRU, hits, wanted, n);
+    bench_cache_policy("cache, SIEVE", HT_EVICT_SIEVE, hits, wanted, n);
+    free(wanted);
+}
+
+// What each reader thread of bench_threads needs to know.
+struct reader_args
+{
+    table *ht;
+    pthread_mutex_t *lock;      // <NULL> for HT_CONCURRENT tables.
+    const char *hits;
+    const size_t *order;
+    size_t n;
+    size_t start;               // Where in <order> this thread starts.
+    size_t found;
+};
+
+static void *reader_thread(void *arg)
+{
+    struct reader_args *args = arg;
+    for (size_t i = 0; i < args->n; i++)
+    {
+        const char *key = &args->hits[args->order[(args->start + i) % args->n] * KEY_LENGTH];
+        if (args->lock != NULL) pthread_mutex_lock(args->lock);
+        if (ht_find(args->ht, key) != NULL) args->found++;
+        if (args->lock != NULL) pthread_mutex_unlock(args->lock);
+    }
+    return NULL;
+}
+
+/**
+ * @brief Every thread looks up all <n> keys, starting at different offsets.
+ * @note With <lock>, that's how we used to share a table between threads.
+ */
+static void bench_threads(const char *name, table *ht, pthread_mutex_t *lock,
+                          const char *hits, const size_t *order, size_t n,
+                          int max_threads)
+{
+    printf("%s\n", name);
+    for (int nthreads = 1; nthreads <= max_threads; nthreads *= 2)
+    {
+        pthread_t threads[nthreads];
+        struct reader_args args[nthreads];
+
+        double start = now_seconds();
+        for (int t = 0; t < nthreads; t++)
+        {
+            args[t] = (struct reader_args){ht, lock, hits, order, n, 
+                                           n / nthreads * t, 0};
+            pthread_create(&threads[t], NULL, reader_thread, &args[t]);
+        }
+        size_t found = 0;
+        for (int t = 0; t < nthreads; t++)
+        {
+            pthread_join(threads[t], NULL);
+            found += args[t].found;
+        }
+        double elapsed = now_seconds() - start;
+
+        printf("    %3i threads: %7.2f M finds/s (%zu found)\n",
+            nthreads, nthreads * n / elapsed / 1e6, found);
+    }
+}
+
+static void bench_concurrent(const char *hits, const size_t *order, size_t n,
+                             int max_threads)
+{
+    table *locked = ht_create((int)n, bench_hash, bench_noclean, HT_CHAINED);
+    table *shared = ht_create((int)n, bench_hash, bench_noclean, HT_CONCURRENT);
+    if (locked == NULL || shared == NULL)
+    {
+        ht_destroy(locked);
+        ht_destroy(shared);
+        return;
+    }
+    for (size_t i = 0; i < n; i++)
+    {
+        ht_insert(locked, &hits[i * KEY_LENGTH], (void *)&hits[i * KEY_LENGTH]);
+        ht_insert(shared, &hits[i * KEY_LENGTH], (void *)&hits[i * KEY_LENGTH]);
+    }
+
+    pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+    bench_threads("chained, 1 global mutex", locked, &lock, 
+                  hits, order, n, max_threads);
+    bench_threads("concurrent, lock-free reads", shared, NULL, 
+                  hits, order, n, max_threads);
+
+    ht_destroy(locked);
+    ht_destroy(shared);
+}
+
+int main(int argc, char *argv[])
+{
+    size_t n = (argc > 1) ? strtoul(argv[1], NULL, 10) : 1000000;
+    int max_threads = (argc > 2) ? atoi(argv[2]) 
+                                 : (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (n == 0 || max_threads <= 0) return EXIT_FAILURE;
+
+    char *hits = make_keys(n, "key:");
+    char *misses = make_keys(n, "missing:");
+    size_t *order = make_order(n);
+    if (hits == NULL || misses == NULL || order == NULL)
+    {
+        free(hits);
+        free(misses);
+        free(order);
+        return EXIT_FAILURE;
+    }
+
+    printf("<< %zu keys >>\n", n);
+    bench_backend("chained", HT_CHAINED, hits, misses, order, n);
+    bench_backend("chained, pooled", HT_CHAINED | HT_POOLED, 
+                  hits, misses, order, n);
+    bench_backend("chained, bloom", HT_CHAINED | HT_BLOOM, 
+                  hits, misses, order, n);
+    bench_backend("open addressing", HT_OPEN_ADDRESSING, hits, misses, order, n);
+    bench_grow(hits, n);
+    bench_hashes(hits, misses, order, n);
+    bench_batch(hits, misses, order, n);
+    bench_upsert(hits, order, n);
+    bench_snapshot(hits, misses, order, n);
+    bench_build(hits, n, max_threads);
+    bench_typed(order, n);
+    bench_inline(hits, order, n);
+    bench_cache(hits, n);
+    bench_concurrent(hits, order, n, max_threads);
+
+    free(hits);
+    free(misses);
+    free(order);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,253 @@
+/**
+ * @file typed_hashtable.h
+ * @brief Header-only generator for hashtables of 1 fixed key and value type.
+ *
+ * genhashtable.h works for any object, but everything goes through
+ * <void *obj>, string keys and a hash function pointer, so the compiler
+ * can't inline a thing. DEFINE_HASHTABLE stamps out a table for exactly
+ * your types instead: keys and values sit inline in 1 flat array, and the
+ * hash and equality checks are expressions the compiler can see through.
+ *
+ * Usage, e.g. for a uint64_t -> uint64_t map:
+ *
+ *     DEFINE_HASHTABLE(u64map, uint64_t, uint64_t, th_hash_u64, th_eq)
+ *
+ *     u64map map;
+ *     u64map_init(&map, 0);
+ *     u64map_insert(&map, 42, 1);
+ *     uint64_t *val = u64map_find(&map, 42);
+ *     u64map_destroy(&map);
+ *
+ * <hash_expr> is called as hash_expr(key) and must give a well spread
+ * uint64_t, <eq_expr> as eq_expr(a, b). Function-like macros or static
+ * inline functions both work.
+ * @note Linear probing with deletion by backward shift, so no tombstones.
+ * 1 control byte per slot holds 7 bits of the hash, so most mismatches
+ * never touch the slot array at all.
+ */
+
+#ifndef TYPED_HASHTABLE_H
+#define TYPED_HASHTABLE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Control byte of an empty slot. Full slots have their high bit set.
+#define TH_EMPTY 0x00
+
+// Don't go past 7/8 full, linear probing gets slow quickly after that.
+#define TH_MAX_LOAD_NUM 7
+#define TH_MAX_LOAD_DEN 8
+
+/**
+ * @brief A cheap, well spread hash for integer keys (a wyhash-style mix).
+ * @note Good for any key that fits in a uint64_t: ints, pointers, enums.
+ */
+static inline uint64_t th_hash_u64(uint64_t key)
+{
+    key ^= key >> 32;
+    key *= 0xd6e8feb86659fd93ULL;
+    key ^= key >> 32;
+    key *= 0xd6e8feb86659fd93ULL;
+    key ^= key >> 32;
+    return key;
+}
+
+// Equality for anything == works on.
+#define th_eq(a, b) ((a) == (b))
+
+/**
+ * @brief Emit a hashtable type called <name> and its functions, name_*.
+ * @param name Name of the table type, and prefix of every function.
+ * @param KeyT Type of the keys, copied into the table by value.
+ * @param ValT Type of the values, copied into the table by value.
+ * @param hash_expr Called as hash_expr(key), returns a uint64_t.
+ * @param eq_expr Called as eq_expr(a, b), true if the 2 keys are equal.
+ * @note Every function is static inline, so use it once per translation unit
+ * per <name>, at file scope.
+ *
+ * The functions it makes:
+ * - bool name_init(name *ht, size_t size): room for <size> entries to start.
+ * - void name_destroy(name *ht): frees the slots, not what values point at.
+ * - ValT *name_find(name *ht, KeyT key): NULL if not found.
+ * - bool name_insert(name *ht, KeyT key, ValT val): false if <key> exists.
+ * - ValT *name_upsert(name *ht, KeyT key, ValT val): insert or overwrite.
+ * - bool name_delete(name *ht, KeyT key): false if not found.
+ * - size_t name_count(name *ht): # of entries.
+ * Pointers from find/upsert are only valid until the next insert or delete.
+ */
+#define DEFINE_HASHTABLE(name, KeyT, ValT, hash_expr, eq_expr)                 \
+                                                                               \
+struct name##_slot                                                             \
+{                                                                              \
+    KeyT key;                                                                  \
+    ValT val;                                                                  \
+};                                                                             \
+                                                                               \
+typedef struct name                                                            \
+{                                                                              \
+    size_t size;                    /* # of slots, a power of 2. */            \
+    size_t count;                   /* # of full slots. */                     \
+    uint8_t *ctrl;                  /* TH_EMPTY, or 0x80 | 7 hash bits. */     \
+    struct name##_slot *slots;                                                 \
+} name;                                                                        \
+                                                                               \
+static inline uint8_t name##_ctrl_of(uint64_t hash)                            \
+{                                                                              \
+    return (uint8_t)(0x80 | (hash >> 57));                                     \
+}                                                                              \
+                                                                               \
+static inline bool name##_alloc(name *ht, size_t size)                         \
+{                                                                              \
+    uint8_t *ctrl = calloc(size, sizeof(uint8_t));                             \
+    struct name##_slot *slots = malloc(size * sizeof(struct name##_slot));     \
+    if (ctrl == NULL || slots == NULL)                                         \
+    {                                                                          \
+        free(ctrl);                                                            \
+        free(slots);                                                           \
+        return false;                                                          \
+    }                                                                          \
+    ht->size = size;                                                           \
+    ht->count = 0;                                                             \
+    ht->ctrl = ctrl;                                                           \
+    ht->slots = slots;                                                         \
+    return true;                                                               \
+}                                                                              \
+                                                                               \
+static inline bool name##_init(name *ht, size_t size)                          \
+{                                                                              \
+    size_t slots = 16;                                                         \
+    while (slots / TH_MAX_LOAD_DEN * TH_MAX_LOAD_NUM < size) slots *= 2;       \
+    return name##_alloc(ht, slots);                                            \
+}                                                                              \
+                                                                               \
+static inline void name##_destroy(name *ht)                                    \
+{                                                                              \
+    free(ht->ctrl);                                                            \
+    free(ht->slots);                                                           \
+    ht->ctrl = NULL;                                                           \
+    ht->slots = NULL;                                                          \
+    ht->size = ht->count = 0;                                                  \
+}                                                                              \
+                                                                               \
+/* Index of <key>'s slot, or of the empty slot that ended the search. */      \
+static inline size_t name##_probe(const name *ht, KeyT key, uint64_t hash,    \
+                                  bool *found)                                 \
+{                                                                              \
+    size_t mask = ht->size - 1;                                                \
+    uint8_t want = name##_ctrl_of(hash);                                       \
+    for (size_t idx = (size_t)hash & mask; ; idx = (idx + 1) & mask)           \
+    {                                                                          \
+        uint8_t ctrl = ht->ctrl[idx];                                          \
+        if (ctrl == TH_EMPTY)                                                  \
+        {                                                                      \
+            *found = false;                                                    \
+            return idx;                                                        \
+        }                                                                      \
+        if (ctrl == want && eq_expr(ht->slots[idx].key, key))                  \
+        {                                                                      \
+            *found = true;                                                     \
+            return idx;                                                        \
+        }                                                                      \
+    }                                                                          \
+}                                                                              \
+                                                                               \
+static inline ValT *name##_find(name *ht, KeyT key)                            \
+{                                                                              \
+    bool found;                                                                \
+    size_t idx = name##_probe(ht, key, hash_expr(key), &found);                \
+    return found ? &ht->slots[idx].val : NULL;                                 \
+}                                                                              \
+                                                                               \
+/* Move every entry to <size> slots, their hashes are computed again. */       \
+static inline bool name##_resize(name *ht, size_t size)                        \
+{                                                                              \
+    name bigger;                                                               \
+    if (!name##_alloc(&bigger, size)) return false;                            \
+    for (size_t i = 0; i < ht->size; i++)                                      \
+    {                                                                          \
+        if (ht->ctrl[i] == TH_EMPTY) continue;                                 \
+        bool found;                                                            \
+        uint64_t hash = hash_expr(ht->slots[i].key);                           \
+        size_t idx = name##_probe(&bigger, ht->slots[i].key, hash, &found);    \
+        bigger.ctrl[idx] = ht->ctrl[i];                                        \
+        bigger.slots[idx] = ht->slots[i];                                      \
+    }                                                                          \
+    bigger.count = ht->count;                                                  \
+    name##_destroy(ht);                                                        \
+    *ht = bigger;                                                              \
+    return true;                                                               \
+}                                                                              \
+                                                                               \
+/* Slot for <key>, a new one if need be. NULL only if we ran out of memory. */ \
+static inline struct name##_slot *name##_slot_for(name *ht, KeyT key,          \
+                                                  bool *inserted)              \
+{                                                                              \
+    uint64_t hash = hash_expr(key);                                            \
+    bool found;                                                                \
+    size_t idx = name##_probe(ht, key, hash, &found);                          \
+    *inserted = !found;                                                        \
+    if (found) return &ht->slots[idx];                                         \
+                                                                               \
+    if ((ht->count + 1) * TH_MAX_LOAD_DEN > ht->size * TH_MAX_LOAD_NUM)        \
+    {                                                                          \
+        if (!name##_resize(ht, ht->size * 2)) return NULL;                     \
+        idx = name##_probe(ht, key, hash, &found);                             \
+    }                                                                          \
+    ht->ctrl[idx] = name##_ctrl_of(hash);                                      \
+    ht->slots[idx].key = key;                                                  \
+    ht->count++;                                                               \
+    return &ht->slots[idx];                                                    \
+}                                                                              \
+                                                                               \
+static inline bool name##_insert(name *ht, KeyT key, ValT val)                 \
+{                                                                              \
+    bool inserted;                                                             \
+    struct name##_slot *slot = name##_slot_for(ht, key, &inserted);            \
+    if (slot == NULL || !inserted) return false;                               \
+    slot->val = val;                                                           \
+    return true;                                                               \
+}                                                                              \
+                                                                               \
+static inline ValT *name##_upsert(name *ht, KeyT key, ValT val)                \
+{                                                                              \
+    bool inserted;                                                             \
+    struct name##_slot *slot = name##_slot_for(ht, key, &inserted);            \
+    if (slot == NULL) return NULL;                                             \
+    slot->val = val;                                                           \
+    return &slot->val;                                                         \
+}                                                                              \
+                                                                               \
+static inline bool name##_delete(name *ht, KeyT key)                           \
+{                                                                              \
+    bool found;                                                                \
+    size_t mask = ht->size - 1;                                                \
+    size_t hole = name##_probe(ht, key, hash_expr(key), &found);               \
+    if (!found) return false;                                                  \
+                                                                               \
+    /* Pull later entries back into the hole, unless that would put them   */ \
+    /* before their home slot. Then every probe still ends at an empty one. */ \
+    for (size_t idx = (hole + 1) & mask; ht->ctrl[idx] != TH_EMPTY;            \
+         idx = (idx + 1) & mask)                                               \
+    {                                                                          \
+        size_t home = (size_t)hash_expr(ht->slots[idx].key) & mask;            \
+        if (((idx - home) & mask) >= ((idx - hole) & mask))                    \
+        {                                                                      \
+            ht->ctrl[hole] = ht->ctrl[idx];                                    \
+            ht->slots[hole] = ht->slots[idx];                                  \
+            hole = idx;                                                        \
+        }                                                                      \
+    }                                                                          \
+    ht->ctrl[hole] = TH_EMPTY;                                                 \
+    ht->count--;                                                               \
+    return true;                                                               \
+}                                                                              \
+                                                                               \
+static inline size_t name##_count(name *ht)                                    \
+{                                                                              \
+    return ht->count;                                                          \
+}
+
+#endif // TYPED_HASHTABLE_H
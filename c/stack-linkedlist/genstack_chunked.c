@@ -0,0 +1,206 @@
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "genstack_chunked.h"
+
+static void default_objprint(void *obj)
+{
+    printf("%p\n", obj);
+}
+
+// Put an empty chunk on top, the spare one if we have it.
+static bool chunk_push(Stack *stack)
+{
+    stackchunk *chunk = stack->spare;
+    if (chunk)
+        stack->spare = NULL;
+    else
+        chunk = malloc(sizeof(stackchunk));
+    if (!chunk) return false;
+
+    chunk->next  = stack->top;
+    chunk->count = 0;
+    if (!stack->top) stack->bottom = chunk;
+    stack->top = chunk;
+    return true;
+}
+
+// Take the (now empty) top chunk off, keep it as the spare if there's none.
+static void chunk_pop(Stack *stack)
+{
+    stackchunk *empty = stack->top;
+    stack->top = empty->next;
+    if (!stack->top) stack->bottom = NULL;
+
+    // Keep 1 around, the next push will probably want it right back.
+    if (!stack->spare)
+        stack->spare = empty;
+    else
+        free(empty);
+}
+
+// Throw away the top <n> objects without looking at them.
+static void stack_drop_n(Stack *stack, size_t n)
+{
+    stack->count -= n;
+    while (n > 0)
+    {
+        size_t take = (n < stack->top->count) ? n : stack->top->count;
+        stack->top->count -= take;
+        n -= take;
+        if (stack->top->count == 0) chunk_pop(stack);
+    }
+}
+
+Stack *stack_init(void *obj, objprint_fn *print_obj, objfree_fn *free_obj)
+{
+    Stack *stack = malloc(sizeof(Stack));
+    if (!stack) return NULL;
+
+    stack->top       = NULL;
+    stack->bottom    = NULL;
+    stack->count     = 0;
+    stack->spare     = NULL;
+    stack->print_obj = (print_obj) ? print_obj : default_objprint;
+    stack->free_obj  = (free_obj)  ? free_obj  : free;
+
+    // Same as the linked version, the first object goes in even if <NULL>.
+    if (!stack_push(stack, obj))
+    {
+        free(stack);
+        return NULL;
+    }
+    return stack;
+}
+
+bool stack_push(Stack *stack, void *obj)
+{
+    if (!stack) return false;
+
+    // Top chunk is full (or there is none), start a new one on top of it.
+    if (!stack->top || stack->top->count == STACK_CHUNK_SLOTS)
+    {
+        if (!chunk_push(stack)) return false;
+    }
+    stack->top->slots[stack->top->count++] = obj;
+    stack->count++;
+    return true;
+}
+
+void *stack_pop(Stack *stack)
+{
+    if (!stack || !stack->top) return NULL;
+
+    // return the object stored to user, if malloc'd they can free it
+    void *obj = stack->top->slots[--stack->top->count];
+    stack->count--;
+
+    // Emptied the top chunk, so the one below (if any) is the top now.
+    if (stack->top->count == 0) chunk_pop(stack);
+    return obj;
+}
+
+bool stack_push_n(Stack *stack, void **objs, size_t n)
+{
+    if (!stack) return false;
+
+    // Fill what's left of the top chunk, then whole new ones, 1 memcpy each.
+    size_t pushed = 0;
+    while (pushed < n)
+    {
+        if (!stack->top || stack->top->count == STACK_CHUNK_SLOTS)
+        {
+            if (!chunk_push(stack))
+            {
+                stack_drop_n(stack, pushed);
+                return false;
+            }
+        }
+        stackchunk *top = stack->top;
+        size_t room = STACK_CHUNK_SLOTS - top->count;
+        size_t take = (n - pushed < room) ? n - pushed : room;
+        memcpy(&top->slots[top->count], &objs[pushed], take * sizeof(void *));
+        top->count   += take;
+        stack->count += take;
+        pushed += take;
+    }
+    return true;
+}
+
+size_t stack_pop_n(Stack *stack, void **objs, size_t n)
+{
+    if (!stack) return 0;
+
+    size_t popped = 0;
+    while (popped < n && stack->top)
+    {
+        // Newest object is at the end of each chunk.
+        stackchunk *top = stack->top;
+        while (popped < n && top->count > 0)
+            objs[popped++] = top->slots[--top->count];
+        if (top->count == 0) chunk_pop(stack);
+    }
+    stack->count -= popped;
+    return popped;
+}
+
+size_t stack_size(Stack *stack)
+{
+    return (stack) ? stack->count : 0;
+}
+
+void stack_splice(Stack *dst, Stack *src)
+{
+    if (!dst || !src || dst == src || !src->top) return;
+
+    // <dst>'s top chunk may not be full, which is why chunks count their own.
+    src->bottom->next = dst->top;
+    if (!dst->top) dst->bottom = src->bottom;
+    dst->top    = src->top;
+    dst->count += src->count;
+
+    src->top    = NULL;
+    src->bottom = NULL;
+    src->count  = 0;
+}
+
+void stack_print(Stack *stack)
+{
+    if (!stack) return;
+
+    size_t i = 1;
+    printf("************************\n");
+    printf("       << START >>\n");
+    for (stackchunk *chunk = stack->top; chunk; chunk = chunk->next)
+    {
+        // Newest object is at the end of each chunk.
+        for (size_t slot = chunk->count; slot > 0; slot--)
+        {
+            printf("%zu.) ", i);
+            stack->print_obj(chunk->slots[slot - 1]);
+            i++;
+        }
+    }
+    printf("        << END >>       \n");
+    printf("************************\n");
+}
+
+void stack_destroy(Stack **ptr_address)
+{
+    Stack *stack = *ptr_address;
+    if (!stack) return;
+
+    stackchunk *chunk = stack->top;
+    while (chunk)
+    {
+        stackchunk *tmp = chunk;
+        chunk = chunk->next;
+        while (tmp->count > 0) stack->free_obj(tmp->slots[--tmp->count]);
+        free(tmp);
+    }
+    free(stack->spare);
+    free(stack);
+    *ptr_address = NULL;
+}
@@ -0,0 +1,116 @@
+#ifndef GENERAL_PURPOSE_STACK_CHUNKED_H
+#define GENERAL_PURPOSE_STACK_CHUNKED_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif // starting { of extern "C"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * Drop-in replacement for genstack_sllist.h: same functions, same rules.
+ * Include one or the other, not both.
+ *
+ * Instead of 1 malloc'd node per object, objects go in chunks of
+ * STACK_CHUNK_SLOTS pointers, and chunks are linked like the nodes were.
+ * So only 1 push in STACK_CHUNK_SLOTS mallocs, and the rest just write
+ * the next slot of an array.
+ */
+
+/**
+ * @brief Specify how you'd like to format your objects' printouts.
+ * @note  Example, pass a wrapper function that contains:
+ * @note  printf("%s\n", (char*)ptr->obj)
+*/
+typedef void objprint_fn(void *obj);
+
+/**
+ * @brief Similar to objprint, specify how you'd like to free your objects.
+ * @note  Pass <NULL> to default to free.
+ * @note  This assumes your objects are dynamically allocated.
+ * @note  Otherwise, pass a function that does nothing.
+*/
+typedef void objfree_fn(void *obj);
+
+// # of objects per chunk, 4 KiB worth of pointers on 64 bit machines.
+#define STACK_CHUNK_SLOTS 512
+
+typedef struct stackchunk
+{
+    struct stackchunk *next;        // The chunk below this one.
+    size_t count;                   // # of slots in use, from slots[0] up.
+    void *slots[STACK_CHUNK_SLOTS];
+}
+stackchunk;
+
+/**
+ * Only stack_splice leaves a chunk below the top less than full, so pushes
+ * and pops still only ever look at <top>.
+ */
+typedef struct stackobj
+{
+    stackchunk *top;        // Chunk the next push or pop goes to, or <NULL>.
+    stackchunk *bottom;     // Last chunk, so stack_splice is O(1).
+    size_t count;           // # of objects in all the chunks together.
+    stackchunk *spare;      // 1 empty chunk kept so a push/pop back and forth
+                            // across a chunk boundary doesn't malloc/free.
+    objfree_fn *free_obj;
+    objprint_fn *print_obj;
+}
+Stack;
+
+/**
+ * @brief           Initialise a general purpose stack.
+ * @param obj       Initial object to start the stack off with, or <NULL>
+ * @param print_fn  Pass <NULL> to print out only the object's address.
+ * @param free_fn   Pass <NULL> to use <free> from stdlib.
+ * @note            Be careful if you pass <NULL> for <obj> though!
+ */
+Stack *stack_init(void *obj, objprint_fn *print_obj, objfree_fn *free_obj);
+
+/**
+ * @brief  Push <obj> on top of the stack.
+ * @return false if a new chunk was needed and we couldn't malloc it.
+ */
+bool stack_push(Stack *stack, void *obj);
+
+/**
+ * @brief Removes the topmost element of the stack.
+ * @return (void*) to the object from the removed element.
+ * @note The object itself is not freed.
+*/
+void *stack_pop(Stack *stack);
+
+/**
+ * @brief  Push <objs>[0] up to <objs>[n - 1], so the last one ends up on top.
+ * @return false if a malloc failed, then none of them were pushed.
+ */
+bool stack_push_n(Stack *stack, void **objs, size_t n);
+
+/**
+ * @brief  Pop up to <n> objects into <objs>, the topmost one first.
+ * @return # of objects popped, less than <n> if the stack ran out.
+ * @note   The objects themselves are not freed.
+ */
+size_t stack_pop_n(Stack *stack, void **objs, size_t n);
+
+// # of objects on the stack, without walking it.
+size_t stack_size(Stack *stack);
+
+/**
+ * @brief Move every object of <src> on top of <dst>, in the same order.
+ *        <src> is left empty but still usable. O(1) however many there are.
+ * @note  <dst> frees them from now on, so give both the same <free_obj>.
+ */
+void stack_splice(Stack *dst, Stack *src);
+
+void stack_print(Stack *stack);
+
+void stack_destroy(Stack **ptr_address);
+
+#ifdef __cplusplus
+}
+#endif // closing } of extern "C"
+
+#endif // GENERAL_PURPOSE_STACK_CHUNKED_H
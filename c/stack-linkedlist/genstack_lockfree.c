@@ -0,0 +1,200 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "genstack_lockfree.h"
+
+#ifndef __GCC_HAVE_SYNC_COMPARE_AND_SWAP_16
+#error "genstack_lockfree.c needs a 16 byte CAS, on x86-64 build with -mcx16"
+#endif
+
+// # of nodes malloc'd at once when the free list runs dry.
+#define LFSTACK_SLAB_NODES 256
+
+__extension__ typedef unsigned __int128 uint128;
+
+typedef struct lfnode
+{
+    void *obj;
+    struct lfnode *next;
+}
+lfnode;
+
+// A top pointer and its swap counter, compared and swapped as 1.
+typedef union lfhead
+{
+    struct
+    {
+        lfnode *node;
+        uintptr_t tag;      // +1 on every swap, see the top of the header.
+    }
+    half;
+    uint128 whole;
+}
+lfhead;
+
+// Nodes come in slabs, kept in a list so lfstack_destroy can free them.
+typedef struct lfslab
+{
+    struct lfslab *next;
+    lfnode nodes[LFSTACK_SLAB_NODES];
+}
+lfslab;
+
+struct lfstack
+{
+    lfhead top;                 // Objects on the stack.
+    lfhead free_nodes;          // Popped nodes, waiting for a push.
+    lfslab *slabs;              // Every slab we malloc'd.
+    objfree_fn *free_obj;
+    objprint_fn *print_obj;
+};
+
+static void default_objprint(void *obj)
+{
+    printf("%p\n", obj);
+}
+
+/**
+ * @brief Read <head>'s pointer and counter.
+ * @note Not 1 atomic read, but a torn one just makes the CAS after it fail.
+ */
+static inline lfhead lf_load(lfhead *head)
+{
+    lfhead copy;
+    copy.half.tag  = __atomic_load_n(&head->half.tag, __ATOMIC_ACQUIRE);
+    copy.half.node = __atomic_load_n(&head->half.node, __ATOMIC_ACQUIRE);
+    return copy;
+}
+
+// Swap <head> from <seen> to <node>, only if nobody swapped it since.
+static inline bool lf_cas(lfhead *head, lfhead seen, lfnode *node)
+{
+    lfhead wanted;
+    wanted.half.node = node;
+    wanted.half.tag  = seen.half.tag + 1;
+    return __sync_bool_compare_and_swap(&head->whole, seen.whole, wanted.whole);
+}
+
+static void lf_push_node(lfhead *head, lfnode *node)
+{
+    for (;;)
+    {
+        lfhead seen = lf_load(head);
+        __atomic_store_n(&node->next, seen.half.node, __ATOMIC_RELAXED);
+        if (lf_cas(head, seen, node)) return;
+    }
+}
+
+static lfnode *lf_pop_node(lfhead *head)
+{
+    for (;;)
+    {
+        lfhead seen = lf_load(head);
+        if (!seen.half.node) return NULL;
+
+        // <seen.half.node> may be popped and reused by now, but never freed,
+        // so this read is safe. If it's stale the CAS fails anyway.
+        lfnode *next = __atomic_load_n(&seen.half.node->next, __ATOMIC_RELAXED);
+        if (lf_cas(head, seen, next)) return seen.half.node;
+    }
+}
+
+/**
+ * @brief Malloc a slab, keep 1 node of it and give the rest to the free list.
+ * @return The node we kept, <NULL> if malloc failed.
+ */
+static lfnode *lf_new_slab(LFStack *stack)
+{
+    lfslab *slab = malloc(sizeof(lfslab));
+    if (!slab) return NULL;
+
+    // Slabs are only ever pushed while the stack is in use, so no ABA here.
+    slab->next = __atomic_load_n(&stack->slabs, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&stack->slabs, &slab->next, slab, true,
+                                        __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+        ;
+
+    for (int i = 1; i < LFSTACK_SLAB_NODES; i++)
+        lf_push_node(&stack->free_nodes, &slab->nodes[i]);
+    return &slab->nodes[0];
+}
+
+LFStack *lfstack_init(objprint_fn *print_obj, objfree_fn *free_obj)
+{
+    // malloc only promises 16 byte alignment, which is just what CAS needs.
+    LFStack *stack = malloc(sizeof(LFStack));
+    if (!stack) return NULL;
+
+    stack->top.whole        = 0;
+    stack->free_nodes.whole = 0;
+    stack->slabs            = NULL;
+    stack->print_obj = (print_obj) ? print_obj : default_objprint;
+    stack->free_obj  = (free_obj)  ? free_obj  : free;
+    return stack;
+}
+
+bool lfstack_push(LFStack *stack, void *obj)
+{
+    if (!stack) return false;
+
+    lfnode *node = lf_pop_node(&stack->free_nodes);
+    if (!node) node = lf_new_slab(stack);
+    if (!node) return false;
+
+    // Nobody else can see <node> until the CAS in lf_push_node publishes it.
+    node->obj = obj;
+    lf_push_node(&stack->top, node);
+    return true;
+}
+
+void *lfstack_pop(LFStack *stack)
+{
+    if (!stack) return NULL;
+
+    lfnode *node = lf_pop_node(&stack->top);
+    if (!node) return NULL;
+
+    // It's ours now, read the object before anyone can reuse the node.
+    void *obj = node->obj;
+    lf_push_node(&stack->free_nodes, node);
+    return obj;
+}
+
+void lfstack_print(LFStack *stack)
+{
+    if (!stack) return;
+
+    size_t i = 1;
+    printf("************************\n");
+    printf("       << START >>\n");
+    for (lfnode *ptr = stack->top.half.node; ptr; ptr = ptr->next)
+    {
+        printf("%zu.) ", i);
+        stack->print_obj(ptr->obj);
+        i++;
+    }
+    printf("        << END >>       \n");
+    printf("************************\n");
+}
+
+void lfstack_destroy(LFStack **ptr_address)
+{
+    LFStack *stack = *ptr_address;
+    if (!stack) return;
+
+    for (lfnode *ptr = stack->top.half.node; ptr; ptr = ptr->next)
+        stack->free_obj(ptr->obj);
+
+    // Every node, on the stack or not, lives in 1 of the slabs.
+    lfslab *slab = stack->slabs;
+    while (slab)
+    {
+        lfslab *tmp = slab;
+        slab = slab->next;
+        free(tmp);
+    }
+    free(stack);
+    *ptr_address = NULL;
+}
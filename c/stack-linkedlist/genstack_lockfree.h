@@ -0,0 +1,72 @@
+#ifndef GENERAL_PURPOSE_STACK_LOCKFREE_H
+#define GENERAL_PURPOSE_STACK_LOCKFREE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif // starting { of extern "C"
+
+#include <stdbool.h>
+
+/**
+ * A Treiber stack: push and pop from any # of threads at once, no locks.
+ * Both just swap the top pointer with 1 compare-and-swap and retry if
+ * another thread got there first.
+ *
+ * The top pointer carries a counter that goes up on every swap, so a node
+ * that was popped and pushed back between our read and our swap can't
+ * fool us (the ABA problem). Popped nodes go on a free list for later
+ * pushes and are only given back to the OS by lfstack_destroy, so a slow
+ * thread can always still read a node it saw on top a moment ago.
+ * @note Needs a 16 byte compare-and-swap: x86-64 (built with -mcx16) or
+ * AArch64.
+ */
+
+/**
+ * @brief Specify how you'd like to format your objects' printouts.
+ * @note  Example, pass a wrapper function that contains:
+ * @note  printf("%s\n", (char*)ptr->obj)
+*/
+typedef void objprint_fn(void *obj);
+
+/**
+ * @brief Similar to objprint, specify how you'd like to free your objects.
+ * @note  Pass <NULL> to default to free.
+ * @note  This assumes your objects are dynamically allocated.
+ * @note  Otherwise, pass a function that does nothing.
+*/
+typedef void objfree_fn(void *obj);
+
+// Opaque, its layout is in genstack_lockfree.c.
+typedef struct lfstack LFStack;
+
+/**
+ * @brief           Initialise an empty lock-free stack.
+ * @param print_fn  Pass <NULL> to print out only the object's address.
+ * @param free_fn   Pass <NULL> to use <free> from stdlib.
+ */
+LFStack *lfstack_init(objprint_fn *print_obj, objfree_fn *free_obj);
+
+/**
+ * @brief  Push <obj> on top of the stack. Safe from any thread.
+ * @return false if we needed more nodes and couldn't malloc them.
+ */
+bool lfstack_push(LFStack *stack, void *obj);
+
+/**
+ * @brief  Remove the topmost element of the stack. Safe from any thread.
+ * @return (void*) to its object, <NULL> if the stack was empty.
+ * @note   The object itself is not freed.
+*/
+void *lfstack_pop(LFStack *stack);
+
+// Not thread-safe: nobody may push or pop meanwhile.
+void lfstack_print(LFStack *stack);
+
+// Not thread-safe: every other thread must be done with the stack.
+void lfstack_destroy(LFStack **ptr_address);
+
+#ifdef __cplusplus
+}
+#endif // closing } of extern "C"
+
+#endif // GENERAL_PURPOSE_STACK_LOCKFREE_H
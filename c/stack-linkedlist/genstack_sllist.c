@@ -24,6 +24,8 @@ Stack *stack_init(void *obj, objprint_fn *print_obj, objfree_fn *free_obj)
 
     stack->list->obj  = obj;
     stack->list->next = NULL;
+    stack->bottom     = stack->list;
+    stack->count      = 1;
 
     stack->print_obj = (print_obj) ? print_obj : default_objprint;
     stack->free_obj  = (free_obj)  ? free_obj  : free;
@@ -41,7 +43,9 @@ bool stack_push(Stack *stack, void *obj)
     top->next = stack->list;
 
     // Put our newly created sllnode to the very top of the stack
+    if (!stack->list) stack->bottom = top;
     stack->list = top;
+    stack->count++;
     return true;
 }
 
@@ -55,10 +59,84 @@ void *stack_pop(Stack *stack)
     // return the object stored to user, if malloc'd they can free it
     void *obj = stack->list->obj;
     stack->list = stack->list->next;
+    if (!stack->list) stack->bottom = NULL;
+    stack->count--;
     free(top);
     return obj;
 }
 
+bool stack_push_n(Stack *stack, void **objs, size_t n)
+{
+    if (!stack) return false;
+    if (n == 0) return true;
+
+    // Chain the new nodes up on the side first, <chain> being the new top.
+    // Nothing touches the stack until every malloc has worked.
+    sllnode *chain = NULL;
+    sllnode *chain_bottom = NULL;
+    for (size_t i = 0; i < n; i++)
+    {
+        sllnode *node = malloc(sizeof(sllnode));
+        if (!node)
+        {
+            while (chain)
+            {
+                sllnode *tmp = chain;
+                chain = chain->next;
+                free(tmp);
+            }
+            return false;
+        }
+        node->obj  = objs[i];
+        node->next = chain;
+        chain = node;
+        if (!chain_bottom) chain_bottom = node;
+    }
+
+    chain_bottom->next = stack->list;
+    if (!stack->list) stack->bottom = chain_bottom;
+    stack->list = chain;
+    stack->count += n;
+    return true;
+}
+
+size_t stack_pop_n(Stack *stack, void **objs, size_t n)
+{
+    if (!stack) return 0;
+
+    size_t popped = 0;
+    while (popped < n && stack->list)
+    {
+        sllnode *top = stack->list;
+        objs[popped++] = top->obj;
+        stack->list = top->next;
+        free(top);
+    }
+    if (!stack->list) stack->bottom = NULL;
+    stack->count -= popped;
+    return popped;
+}
+
+size_t stack_size(Stack *stack)
+{
+    return (stack) ? stack->count : 0;
+}
+
+void stack_splice(Stack *dst, Stack *src)
+{
+    if (!dst || !src || dst == src || !src->list) return;
+
+    // <src>'s bottom node now sits right on top of <dst>'s old top.
+    src->bottom->next = dst->list;
+    if (!dst->list) dst->bottom = src->bottom;
+    dst->list   = src->list;
+    dst->count += src->count;
+
+    src->list   = NULL;
+    src->bottom = NULL;
+    src->count  = 0;
+}
+
 void stack_print(Stack *stack)
 {
     if (!stack) return;
@@ -6,6 +6,7 @@ extern "C" {
 #endif // starting { of extern "C"
 
 #include <stdbool.h>
+#include <stddef.h>
 
 /** 
  * @brief Specify how you'd like to format your objects' printouts. 
@@ -34,6 +35,8 @@ sllnode;
 typedef struct stackobj
 {
     sllnode *list;          // Our stack proper is just a singly linked list.
+    sllnode *bottom;        // Last node of <list>, so stack_splice is O(1).
+    size_t count;           // # of objects in <list>.
     objfree_fn *free_obj;
     objprint_fn *print_obj;
 } 
@@ -57,6 +60,29 @@ bool stack_push(Stack *stack, void *obj);
 */
 void *stack_pop(Stack *stack);
 
+/**
+ * @brief  Push <objs>[0] up to <objs>[n - 1], so the last one ends up on top.
+ * @return false if a malloc failed, then none of them were pushed.
+ */
+bool stack_push_n(Stack *stack, void **objs, size_t n);
+
+/**
+ * @brief  Pop up to <n> objects into <objs>, the topmost one first.
+ * @return # of objects popped, less than <n> if the stack ran out.
+ * @note   The objects themselves are not freed.
+ */
+size_t stack_pop_n(Stack *stack, void **objs, size_t n);
+
+// # of objects on the stack, without walking it.
+size_t stack_size(Stack *stack);
+
+/**
+ * @brief Move every object of <src> on top of <dst>, in the same order.
+ *        <src> is left empty but still usable. O(1) however many there are.
+ * @note  <dst> frees them from now on, so give both the same <free_obj>.
+ */
+void stack_splice(Stack *dst, Stack *src);
+
 void stack_print(Stack *stack);
 
 void stack_destroy(Stack **ptr_address);
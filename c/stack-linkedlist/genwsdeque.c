@@ -0,0 +1,204 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "genwsdeque.h"
+
+// Keeps <top> and <bottom> on separate cache lines, 1 is the owner's.
+#define WSDEQUE_CACHE_LINE 64
+
+// A power of 2 # of slots, so an index wraps around with just a mask.
+typedef struct wsarray
+{
+    struct wsarray *older;      // The array this one replaced, or <NULL>.
+    int64_t size;
+    void *slots[];
+}
+wsarray;
+
+/**
+ * Objects live at indices <top> up to <bottom> - 1, each one at
+ * slots[index & (size - 1)]. Neither index ever goes down for good:
+ * thieves move <top> up, the owner moves <bottom> either way.
+ */
+struct wsdeque
+{
+    int64_t top;                // Next to steal, only ever swapped with CAS.
+    char pad_top[WSDEQUE_CACHE_LINE - sizeof(int64_t)];
+    int64_t bottom;             // Next free slot, only the owner writes it.
+    char pad_bottom[WSDEQUE_CACHE_LINE - sizeof(int64_t)];
+    wsarray *array;
+    objfree_fn *free_obj;
+    objprint_fn *print_obj;
+};
+
+static void default_objprint(void *obj)
+{
+    printf("%p\n", obj);
+}
+
+static wsarray *ws_new_array(int64_t size)
+{
+    wsarray *array = malloc(sizeof(wsarray) + sizeof(void *) * size);
+    if (!array) return NULL;
+
+    array->older = NULL;
+    array->size  = size;
+    return array;
+}
+
+static inline void *ws_get(wsarray *array, int64_t i)
+{
+    return __atomic_load_n(&array->slots[i & (array->size - 1)],
+                           __ATOMIC_RELAXED);
+}
+
+static inline void ws_put(wsarray *array, int64_t i, void *obj)
+{
+    __atomic_store_n(&array->slots[i & (array->size - 1)], obj,
+                     __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Copy objects <top> to <bottom> - 1 into an array twice the size.
+ * @return The new array, <NULL> if malloc failed.
+ * @note The old one stays valid, a thief may be reading it right now.
+ */
+static wsarray *ws_grow(WSDeque *deque, wsarray *old, int64_t top,
+                        int64_t bottom)
+{
+    wsarray *array = ws_new_array(old->size * 2);
+    if (!array) return NULL;
+
+    for (int64_t i = top; i < bottom; i++)
+        ws_put(array, i, ws_get(old, i));
+    array->older = old;
+    __atomic_store_n(&deque->array, array, __ATOMIC_RELEASE);
+    return array;
+}
+
+WSDeque *wsdeque_init(objprint_fn *print_obj, objfree_fn *free_obj)
+{
+    WSDeque *deque = malloc(sizeof(WSDeque));
+    if (!deque) return NULL;
+
+    deque->array = ws_new_array(WSDEQUE_INITIAL_SLOTS);
+    if (!deque->array)
+    {
+        free(deque);
+        return NULL;
+    }
+    deque->top       = 0;
+    deque->bottom    = 0;
+    deque->print_obj = (print_obj) ? print_obj : default_objprint;
+    deque->free_obj  = (free_obj)  ? free_obj  : free;
+    return deque;
+}
+
+bool wsdeque_push(WSDeque *deque, void *obj)
+{
+    if (!deque) return false;
+
+    int64_t bottom = __atomic_load_n(&deque->bottom, __ATOMIC_RELAXED);
+    int64_t top = __atomic_load_n(&deque->top, __ATOMIC_ACQUIRE);
+    wsarray *array = __atomic_load_n(&deque->array, __ATOMIC_RELAXED);
+
+    if (bottom - top >= array->size)
+    {
+        array = ws_grow(deque, array, top, bottom);
+        if (!array) return false;
+    }
+    ws_put(array, bottom, obj);
+
+    // Release so a thief that sees the new <bottom> also sees <obj>.
+    __atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+void *wsdeque_pop(WSDeque *deque)
+{
+    if (!deque) return NULL;
+
+    int64_t bottom = __atomic_load_n(&deque->bottom, __ATOMIC_RELAXED) - 1;
+    wsarray *array = __atomic_load_n(&deque->array, __ATOMIC_RELAXED);
+
+    // Claim the bottom object first, then look at <top>. The fence makes sure
+    // a thief can't miss our claim while we miss its steal.
+    __atomic_store_n(&deque->bottom, bottom, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    int64_t top = __atomic_load_n(&deque->top, __ATOMIC_RELAXED);
+
+    if (top > bottom)
+    {
+        // Was already empty, put <bottom> back.
+        __atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_RELAXED);
+        return NULL;
+    }
+
+    void *obj = ws_get(array, bottom);
+    if (top == bottom)
+    {
+        // Last one left, race the thieves for it the same way they do.
+        if (!__atomic_compare_exchange_n(&deque->top, &top, top + 1, false,
+                                         __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+            obj = NULL;
+        __atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_RELAXED);
+    }
+    return obj;
+}
+
+void *wsdeque_steal(WSDeque *deque)
+{
+    if (!deque) return NULL;
+
+    int64_t top = __atomic_load_n(&deque->top, __ATOMIC_ACQUIRE);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    int64_t bottom = __atomic_load_n(&deque->bottom, __ATOMIC_ACQUIRE);
+    if (top >= bottom) return NULL;
+
+    // Read before the CAS: once <top> moves, the owner may reuse the slot.
+    wsarray *array = __atomic_load_n(&deque->array, __ATOMIC_ACQUIRE);
+    void *obj = ws_get(array, top);
+    if (!__atomic_compare_exchange_n(&deque->top, &top, top + 1, false,
+                                     __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+        return NULL;
+    return obj;
+}
+
+void wsdeque_print(WSDeque *deque)
+{
+    if (!deque) return;
+
+    size_t i = 1;
+    printf("************************\n");
+    printf("       << START >>\n");
+    // Owner's end first, like the stacks print their top first.
+    for (int64_t idx = deque->bottom - 1; idx >= deque->top; idx--)
+    {
+        printf("%zu.) ", i);
+        deque->print_obj(ws_get(deque->array, idx));
+        i++;
+    }
+    printf("        << END >>       \n");
+    printf("************************\n");
+}
+
+void wsdeque_destroy(WSDeque **ptr_address)
+{
+    WSDeque *deque = *ptr_address;
+    if (!deque) return;
+
+    for (int64_t idx = deque->top; idx < deque->bottom; idx++)
+        deque->free_obj(ws_get(deque->array, idx));
+
+    wsarray *array = deque->array;
+    while (array)
+    {
+        wsarray *tmp = array;
+        array = array->older;
+        free(tmp);
+    }
+    free(deque);
+    *ptr_address = NULL;
+}
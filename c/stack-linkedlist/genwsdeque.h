@@ -0,0 +1,81 @@
+#ifndef GENERAL_PURPOSE_WORK_STEALING_DEQUE_H
+#define GENERAL_PURPOSE_WORK_STEALING_DEQUE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif // starting { of extern "C"
+
+#include <stdbool.h>
+
+/**
+ * A Chase-Lev work-stealing deque. 1 thread, the owner, pushes and pops
+ * at the bottom like a stack, without locks or compare-and-swap (bar the
+ * last object, which a thief may want too). Any other thread can steal
+ * from the top, the oldest end, with 1 compare-and-swap.
+ *
+ * Objects sit in a circular array that doubles when full. Thieves may
+ * still be reading the old one, so old arrays are kept around and only
+ * freed by wsdeque_destroy.
+ * @note Objects must not be <NULL>, that's what pop and steal return when
+ * there's nothing to take.
+ */
+
+/**
+ * @brief Specify how you'd like to format your objects' printouts.
+ * @note  Example, pass a wrapper function that contains:
+ * @note  printf("%s\n", (char*)ptr->obj)
+*/
+typedef void objprint_fn(void *obj);
+
+/**
+ * @brief Similar to objprint, specify how you'd like to free your objects.
+ * @note  Pass <NULL> to default to free.
+ * @note  This assumes your objects are dynamically allocated.
+ * @note  Otherwise, pass a function that does nothing.
+*/
+typedef void objfree_fn(void *obj);
+
+// # of slots the array starts with, doubled every time it fills up.
+#define WSDEQUE_INITIAL_SLOTS 256
+
+// Opaque, its layout is in genwsdeque.c.
+typedef struct wsdeque WSDeque;
+
+/**
+ * @brief           Initialise an empty deque.
+ * @param print_fn  Pass <NULL> to print out only the object's address.
+ * @param free_fn   Pass <NULL> to use <free> from stdlib.
+ */
+WSDeque *wsdeque_init(objprint_fn *print_obj, objfree_fn *free_obj);
+
+/**
+ * @brief  Push <obj> on the bottom. Owner thread only.
+ * @return false if the array was full and we couldn't malloc a bigger one.
+ */
+bool wsdeque_push(WSDeque *deque, void *obj);
+
+/**
+ * @brief  Take the newest object back off the bottom. Owner thread only.
+ * @return (void*) to the object, <NULL> if the deque was empty or a thief
+ *         took the last one.
+ */
+void *wsdeque_pop(WSDeque *deque);
+
+/**
+ * @brief  Take the oldest object off the top. Safe from any thread.
+ * @return (void*) to the object, <NULL> if the deque was empty or another
+ *         thread took it first.
+ */
+void *wsdeque_steal(WSDeque *deque);
+
+// Not thread-safe: nobody may push, pop or steal meanwhile.
+void wsdeque_print(WSDeque *deque);
+
+// Not thread-safe: every other thread must be done with the deque.
+void wsdeque_destroy(WSDeque **ptr_address);
+
+#ifdef __cplusplus
+}
+#endif // closing } of extern "C"
+
+#endif // GENERAL_PURPOSE_WORK_STEALING_DEQUE_H
@@ -0,0 +1,138 @@
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "genwsdeque.h"
+#include "genwspool.h"
+
+typedef struct wspool WSPool;
+
+struct wsworker
+{
+    WSPool *pool;
+    WSDeque *deque;
+    int id;
+    uint32_t seed;              // xorshift state, for picking victims.
+    pthread_t thread;
+};
+
+struct wspool
+{
+    WSWorker *workers;
+    int nworkers;
+    wstask_fn *fn;
+    void *arg;
+    size_t pending;             // Tasks spawned but not finished yet.
+};
+
+// Tasks are never freed by us, they belong to the caller.
+static void ws_nofree(void *obj)
+{
+    (void)obj;
+}
+
+static uint32_t ws_random(WSWorker *self)
+{
+    uint32_t x = self->seed;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    self->seed = x;
+    return x;
+}
+
+// Try every other worker once, starting from a random one.
+static void *ws_steal(WSWorker *self)
+{
+    WSPool *pool = self->pool;
+    int start = (int)(ws_random(self) % (uint32_t)pool->nworkers);
+    for (int i = 0; i < pool->nworkers; i++)
+    {
+        WSWorker *victim = &pool->workers[(start + i) % pool->nworkers];
+        if (victim == self) continue;
+
+        void *task = wsdeque_steal(victim->deque);
+        if (task) return task;
+    }
+    return NULL;
+}
+
+static void *ws_loop(void *arg)
+{
+    WSWorker *self = arg;
+    WSPool *pool = self->pool;
+
+    // Nobody can spawn once <pending> hits 0, there's no task left to do it.
+    while (__atomic_load_n(&pool->pending, __ATOMIC_ACQUIRE) != 0)
+    {
+        void *task = wsdeque_pop(self->deque);
+        if (!task) task = ws_steal(self);
+        if (!task)
+        {
+            sched_yield();
+            continue;
+        }
+        pool->fn(self, task, pool->arg);
+        __atomic_fetch_sub(&pool->pending, 1, __ATOMIC_RELEASE);
+    }
+    return NULL;
+}
+
+void ws_spawn(WSWorker *self, void *task)
+{
+    // Count it first, so <pending> can't reach 0 while it's in a deque.
+    __atomic_fetch_add(&self->pool->pending, 1, __ATOMIC_RELAXED);
+    if (wsdeque_push(self->deque, task)) return;
+
+    __atomic_fetch_sub(&self->pool->pending, 1, __ATOMIC_RELAXED);
+    self->pool->fn(self, task, self->pool->arg);
+}
+
+int ws_worker_id(WSWorker *self)
+{
+    return self->id;
+}
+
+bool ws_run(int nthreads, wstask_fn *fn, void *arg, void *task)
+{
+    if (nthreads < 1 || !fn || !task) return false;
+
+    WSPool pool = {
+        .nworkers = nthreads, .fn = fn, .arg = arg, .pending = 1,
+    };
+    pool.workers = calloc(nthreads, sizeof(WSWorker));
+    if (!pool.workers) return false;
+
+    bool ok = true;
+    for (int i = 0; i < nthreads; i++)
+    {
+        WSWorker *worker = &pool.workers[i];
+        worker->pool  = &pool;
+        worker->id    = i;
+        worker->seed  = 2463534242u + (uint32_t)i * 2654435761u;
+        worker->deque = wsdeque_init(NULL, ws_nofree);
+        if (!worker->deque) ok = false;
+    }
+    if (ok) ok = wsdeque_push(pool.workers[0].deque, task);
+
+    if (ok)
+    {
+        // Worker 0 is us, a worker whose thread didn't start just stays empty.
+        bool started[nthreads];
+        for (int i = 1; i < nthreads; i++)
+            started[i] = pthread_create(&pool.workers[i].thread, NULL, ws_loop,
+                                        &pool.workers[i]) == 0;
+        ws_loop(&pool.workers[0]);
+        for (int i = 1; i < nthreads; i++)
+        {
+            if (started[i]) pthread_join(pool.workers[i].thread, NULL);
+        }
+    }
+
+    for (int i = 0; i < nthreads; i++)
+        wsdeque_destroy(&pool.workers[i].deque);
+    free(pool.workers);
+    return ok;
+}
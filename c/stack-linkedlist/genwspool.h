@@ -0,0 +1,54 @@
+#ifndef GENERAL_PURPOSE_WORK_STEALING_POOL_H
+#define GENERAL_PURPOSE_WORK_STEALING_POOL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif // starting { of extern "C"
+
+#include <stdbool.h>
+
+/**
+ * A small work-stealing scheduler on top of genwsdeque.h. Every worker
+ * thread owns a deque: tasks it spawns go on the bottom of its own, and it
+ * runs the newest one first, like a recursive call would. A worker with
+ * nothing left steals the oldest task of a random other worker, which
+ * tends to be the biggest chunk of work that worker has.
+ *
+ * Tasks are just (void*) the caller picks, e.g. a tree node to walk.
+ * ws_run returns once every task, spawned ones included, has finished.
+ */
+
+// Opaque, 1 per thread. Only valid inside the task function it's passed to.
+typedef struct wsworker WSWorker;
+
+/**
+ * @brief       What to do with 1 task.
+ * @param self  The worker running it, for ws_spawn and ws_worker_id.
+ * @param task  The (void*) given to ws_run or ws_spawn.
+ * @param arg   The <arg> given to ws_run, the same for every task.
+ */
+typedef void wstask_fn(WSWorker *self, void *task, void *arg);
+
+/**
+ * @brief           Run <task> and everything it spawns on <nthreads> threads.
+ * @param nthreads  # of workers, the calling thread counts as 1 of them.
+ * @param task      Must not be <NULL>, same for the spawned ones.
+ * @return          false if <nthreads> < 1 or we couldn't malloc the workers.
+ * @note            If some threads can't be started, the rest do their work.
+ */
+bool ws_run(int nthreads, wstask_fn *fn, void *arg, void *task);
+
+/**
+ * @brief  Queue <task> to run later, on this worker or a thief.
+ * @note   If the deque can't grow, <task> just runs right here instead.
+ */
+void ws_spawn(WSWorker *self, void *task);
+
+// 0 to <nthreads> - 1, e.g. to pick a per-thread result slot.
+int ws_worker_id(WSWorker *self);
+
+#ifdef __cplusplus
+}
+#endif // closing } of extern "C"
+
+#endif // GENERAL_PURPOSE_WORK_STEALING_POOL_H
@@ -0,0 +1,144 @@
+/**
+ * @file lfstack_bench.c
+ * @brief Contention benchmark: genstack_lockfree vs. genstack_sllist behind
+ * 1 mutex, from 1 thread up to N all hammering the same stack.
+ * Usage: ./lfstack_bench [#ops per thread] [max #threads]
+ */
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "genstack_lockfree.h"
+#include "genstack_sllist.h"
+
+// Objects are just numbers cast to pointers, nothing to free.
+static void bench_nofree(void *obj)
+{
+    (void)obj;
+}
+
+static double now_seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// What each thread needs to know, either stack works.
+struct worker_args
+{
+    LFStack *lfstack;
+    Stack *stack;                   // Only used along with <lock>.
+    pthread_mutex_t *lock;
+    size_t ops;
+    uintptr_t sum;
+};
+
+// Push 2, pop 2, over and over: the stack stays shallow and contended.
+static void *lf_worker(void *arg)
+{
+    struct worker_args *args = arg;
+    uintptr_t sum = 0;
+    for (size_t i = 0; i < args->ops; i += 4)
+    {
+        lfstack_push(args->lfstack, (void *)(uintptr_t)i);
+        lfstack_push(args->lfstack, (void *)(uintptr_t)i);
+        sum += (uintptr_t)lfstack_pop(args->lfstack);
+        sum += (uintptr_t)lfstack_pop(args->lfstack);
+    }
+    args->sum = sum;
+    return NULL;
+}
+
+static void *mutex_worker(void *arg)
+{
+    struct worker_args *args = arg;
+    uintptr_t sum = 0;
+    for (size_t i = 0; i < args->ops; i += 4)
+    {
+        pthread_mutex_lock(args->lock);
+        stack_push(args->stack, (void *)(uintptr_t)i);
+        pthread_mutex_unlock(args->lock);
+        pthread_mutex_lock(args->lock);
+        stack_push(args->stack, (void *)(uintptr_t)i);
+        pthread_mutex_unlock(args->lock);
+        pthread_mutex_lock(args->lock);
+        sum += (uintptr_t)stack_pop(args->stack);
+        pthread_mutex_unlock(args->lock);
+        pthread_mutex_lock(args->lock);
+        sum += (uintptr_t)stack_pop(args->stack);
+        pthread_mutex_unlock(args->lock);
+    }
+    args->sum = sum;
+    return NULL;
+}
+
+/**
+ * @brief Run <fn> on <nthreads> threads at once.
+ * @return Millions of push/pop calls per second, all threads together.
+ */
+static double run_threads(void *(*fn)(void *), struct worker_args *proto,
+                          int nthreads)
+{
+    pthread_t ids[nthreads];
+    struct worker_args args[nthreads];
+    bool started[nthreads];
+
+    double start = now_seconds();
+    for (int t = 0; t < nthreads; t++)
+    {
+        args[t] = *proto;
+        started[t] = pthread_create(&ids[t], NULL, fn, &args[t]) == 0;
+        if (!started[t]) fn(&args[t]);
+    }
+    for (int t = 0; t < nthreads; t++)
+    {
+        if (started[t]) pthread_join(ids[t], NULL);
+    }
+    double elapsed = now_seconds() - start;
+    return (double)proto->ops * nthreads / elapsed / 1e6;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t ops = (argc > 1) ? strtoul(argv[1], NULL, 10) : 4000000;
+    int max_threads = (argc > 2) ? atoi(argv[2])
+                                 : (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (ops == 0 || max_threads <= 0) return EXIT_FAILURE;
+
+    LFStack *lfstack = lfstack_init(NULL, bench_nofree);
+    Stack *stack = stack_init(NULL, NULL, bench_nofree);
+    pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+    if (!lfstack || !stack)
+    {
+        lfstack_destroy(&lfstack);
+        if (stack) stack_destroy(&stack);
+        return EXIT_FAILURE;
+    }
+
+    printf("<< %zu ops per thread >>\n", ops);
+    printf("threads   lock-free     mutex\n");
+    // 1, 2, 4... threads, and always <max_threads> last even if it's not 2^n.
+    int nthreads = 1;
+    for (;;)
+    {
+        struct worker_args proto = {
+            .lfstack = lfstack, .stack = stack, .lock = &lock, .ops = ops,
+        };
+        double lf = run_threads(lf_worker, &proto, nthreads);
+        double locked = run_threads(mutex_worker, &proto, nthreads);
+        printf("%7i %8.1f M/s %8.1f M/s\n", nthreads, lf, locked);
+
+        if (nthreads == max_threads) break;
+        nthreads = (nthreads * 2 < max_threads) ? nthreads * 2 : max_threads;
+    }
+
+    lfstack_destroy(&lfstack);
+    stack_destroy(&stack);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,203 @@
+/**
+ * @file stack_bench.c
+ * @brief Rough benchmarks for the generic stack.
+ * Built twice by the Makefile: once against genstack_sllist.c, once against
+ * genstack_chunked.c with STACK_CHUNKED defined. Same code, same API.
+ * Checks stack_splice first, since nothing else here calls it.
+ * Usage: ./stack_bench_linked [#objects], ./stack_bench_chunked [#objects]
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#ifdef STACK_CHUNKED
+#include "genstack_chunked.h"
+#define STACK_KIND "chunked"
+#else
+#include "genstack_sllist.h"
+#define STACK_KIND "linked"
+#endif
+
+// Objects are just numbers cast to pointers, nothing to free.
+static void bench_nofree(void *obj)
+{
+    (void)obj;
+}
+
+static double now_seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void report(const char *name, double elapsed, size_t ops, uintptr_t sum)
+{
+    // Print <sum> so the compiler can't throw the pops away.
+    printf("    %-24s %6.2f ns/op (sum %llu)\n",
+        name, elapsed * 1e9 / ops, (unsigned long long)sum);
+}
+
+// DFS-like: push everything, then pop everything.
+static void bench_fill_drain(Stack *stack, size_t n)
+{
+    uintptr_t sum = 0;
+    double start = now_seconds();
+    for (size_t i = 0; i < n; i++) stack_push(stack, (void *)(uintptr_t)i);
+    for (size_t i = 0; i < n; i++) sum += (uintptr_t)stack_pop(stack);
+    report("push n, pop n:", now_seconds() - start, 2 * n, sum);
+}
+
+// Undo-log-like: grow and shrink by a few hundred at a time, over and over.
+static void bench_sawtooth(Stack *stack, size_t n)
+{
+    uintptr_t sum = 0;
+    size_t ops = 0;
+    double start = now_seconds();
+    while (ops < 2 * n)
+    {
+        for (size_t i = 0; i < 700; i++) stack_push(stack, (void *)(uintptr_t)i);
+        for (size_t i = 0; i < 700; i++) sum += (uintptr_t)stack_pop(stack);
+        ops += 1400;
+    }
+    report("sawtooth by 700:", now_seconds() - start, ops, sum);
+}
+
+// Worst case for chunks: 1 push/pop pair right at a chunk boundary.
+static void bench_boundary(Stack *stack, size_t n)
+{
+    for (size_t i = 0; i < 511; i++) stack_push(stack, (void *)(uintptr_t)i);
+
+    uintptr_t sum = 0;
+    double start = now_seconds();
+    for (size_t i = 0; i < n; i++)
+    {
+        stack_push(stack, (void *)(uintptr_t)i);
+        stack_push(stack, (void *)(uintptr_t)i);
+        sum += (uintptr_t)stack_pop(stack);
+        sum += (uintptr_t)stack_pop(stack);
+    }
+    report("back and forth at 512:", now_seconds() - start, 4 * n, sum);
+
+    for (size_t i = 0; i < 511; i++) stack_pop(stack);
+}
+
+// Batch-processor-like: move work in and out 64 objects per call.
+static void bench_bulk(Stack *stack, size_t n)
+{
+    void *batch[64];
+    for (size_t i = 0; i < 64; i++) batch[i] = (void *)(uintptr_t)i;
+
+    uintptr_t sum = 0;
+    double start = now_seconds();
+    for (size_t i = 0; i < n; i += 64) stack_push_n(stack, batch, 64);
+    while (stack_size(stack) > 1)
+    {
+        size_t popped = stack_pop_n(stack, batch, 64);
+        for (size_t i = 0; i < popped; i++) sum += (uintptr_t)batch[i];
+    }
+    report("push_n/pop_n by 64:", now_seconds() - start, 2 * n, sum);
+}
+
+// Push <first> up to but not including <last>, so <last> - 1 is on top.
+static void push_range(Stack *stack, uintptr_t first, uintptr_t last)
+{
+    for (uintptr_t i = first; i < last; i++) stack_push(stack, (void *)i);
+}
+
+/**
+ * @brief Splice into an empty stack, then into one whose top chunk is only
+ * partly full, then splice the result onto a 3rd stack so its bottom gets
+ * used too. Pop it all back out. 700 and 300 aren't multiples of 512, so
+ * the chunked stack ends up with part full chunks in the middle.
+ * @return false, after saying where, if any object or size was wrong.
+ */
+static bool check_splice(void)
+{
+    Stack *dst = stack_init(NULL, NULL, bench_nofree);
+    Stack *src = stack_init(NULL, NULL, bench_nofree);
+    if (!dst || !src) return false;
+
+    // stack_init always pushes its 1st object, pop it so both start empty.
+    stack_pop(dst);
+    stack_pop(src);
+
+    bool ok = true;
+    push_range(src, 201, 901);
+    stack_splice(dst, src);
+    if (stack_size(dst) != 700 || stack_size(src) != 0)
+    {
+        printf("    splice into empty: size %zu and %zu, wanted 700 and 0\n",
+            stack_size(dst), stack_size(src));
+        ok = false;
+    }
+
+    // <src> must still work after being emptied.
+    push_range(src, 901, 1201);
+    stack_splice(dst, src);
+    push_range(dst, 1201, 1301);
+    if (stack_size(dst) != 1100 || stack_size(src) != 0)
+    {
+        printf("    splice onto 700: size %zu and %zu, wanted 1100 and 0\n",
+            stack_size(dst), stack_size(src));
+        ok = false;
+    }
+
+    push_range(src, 1, 201);
+    stack_splice(src, dst);
+    if (stack_size(src) != 1300 || stack_size(dst) != 0)
+    {
+        printf("    splice onto 200: size %zu and %zu, wanted 1300 and 0\n",
+            stack_size(src), stack_size(dst));
+        ok = false;
+    }
+
+    // Everything went on in order 1..1300, so it comes off 1300..1.
+    for (uintptr_t want = 1300; want > 0 && ok; want--)
+    {
+        uintptr_t got = (uintptr_t)stack_pop(src);
+        if (got != want || stack_size(src) != want - 1)
+        {
+            printf("    pop: got %llu with %zu left, wanted %llu with %llu\n",
+                (unsigned long long)got, stack_size(src),
+                (unsigned long long)want, (unsigned long long)(want - 1));
+            ok = false;
+        }
+    }
+    if (ok && stack_pop(src) != NULL)
+    {
+        printf("    pop: stack should be empty\n");
+        ok = false;
+    }
+
+    stack_destroy(&dst);
+    stack_destroy(&src);
+    return ok;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t n = (argc > 1) ? strtoul(argv[1], NULL, 10) : 10000000;
+    if (n == 0) return EXIT_FAILURE;
+
+    Stack *stack = stack_init(NULL, NULL, bench_nofree);
+    if (!stack) return EXIT_FAILURE;
+
+    printf("<< %s stack, %zu objects >>\n", STACK_KIND, n);
+    if (!check_splice())
+    {
+        printf("    stack_splice is broken, not benchmarking\n");
+        stack_destroy(&stack);
+        return EXIT_FAILURE;
+    }
+    bench_fill_drain(stack, n);
+    bench_sawtooth(stack, n);
+    bench_boundary(stack, n);
+    bench_bulk(stack, n);
+
+    stack_destroy(&stack);
+    return EXIT_SUCCESS;
+}
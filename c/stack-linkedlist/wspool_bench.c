@@ -0,0 +1,156 @@
+/**
+ * @file wspool_bench.c
+ * @brief Parallel tree walk on genwspool.h: visit every node of a bt_root
+ * from ../binary-tree, 1 thread up to N, against a plain recursive walk.
+ * Usage: ./wspool_bench [#nodes] [work per node] [max #threads]
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "genbinarytree.h"
+#include "genwspool.h"
+
+// 1 per worker, padded so 2 threads' sums never share a cache line.
+struct walk_result
+{
+    uint64_t sum;
+    char pad[64 - sizeof(uint64_t)];
+};
+
+struct walk_args
+{
+    struct walk_result *results;
+    unsigned work;
+};
+
+static double now_seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * @brief Stand-in for real per-node work: <work> rounds of a hash mix.
+ * @note Ends up the same for the same <obj>, so every walk's sum should match.
+ */
+static uint64_t visit(void *obj, unsigned work)
+{
+    uint64_t x = (uint64_t)*(int *)obj;
+    for (unsigned i = 0; i < work; i++)
+    {
+        x ^= x >> 33;
+        x *= 0xff51afd7ed558ccdULL;
+        x ^= x >> 33;
+    }
+    return x;
+}
+
+static uint64_t walk_recursive(bt_branch *node, unsigned work)
+{
+    uint64_t sum = 0;
+    while (node)
+    {
+        sum += visit(node->obj, work);
+        sum += walk_recursive(node->rchild, work);
+        node = node->lchild;
+    }
+    return sum;
+}
+
+// Hand the right subtree to whoever wants it, keep going down the left.
+static void walk_task(WSWorker *self, void *task, void *arg)
+{
+    struct walk_args *args = arg;
+    uint64_t sum = 0;
+    for (bt_branch *node = task; node; node = node->lchild)
+    {
+        sum += visit(node->obj, args->work);
+        if (node->rchild) ws_spawn(self, node->rchild);
+    }
+    args->results[ws_worker_id(self)].sum += sum;
+}
+
+// Fisher-Yates, so the tree comes out about 2 log2(n) deep, not n.
+static void shuffle(int *values, size_t count)
+{
+    for (size_t i = count - 1; i > 0; i--)
+    {
+        size_t j = (size_t)rand() % (i + 1);
+        int tmp = values[i];
+        values[i] = values[j];
+        values[j] = tmp;
+    }
+}
+
+// Objects point into 1 array the bench frees itself.
+static void bench_nofree(void *obj)
+{
+    (void)obj;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t count = (argc > 1) ? strtoul(argv[1], NULL, 10) : 1000000;
+    unsigned work = (argc > 2) ? (unsigned)strtoul(argv[2], NULL, 10) : 50;
+    int max_threads = (argc > 3) ? atoi(argv[3])
+                                 : (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (count == 0 || max_threads <= 0) return EXIT_FAILURE;
+
+    int *values = malloc(sizeof(int) * count);
+    struct walk_result *results = calloc(max_threads, sizeof(*results));
+    bt_root *tree = bt_init(NULL, NULL, bench_nofree, BT_PLAIN);
+    if (!values || !results || !tree)
+    {
+        free(values);
+        free(results);
+        bt_destroy(&tree);
+        return EXIT_FAILURE;
+    }
+
+    srand(42);
+    for (size_t i = 0; i < count; i++)
+        values[i] = (int)i;
+    shuffle(values, count);
+    for (size_t i = 0; i < count; i++)
+        bt_insert(tree, &values[i]);
+
+    double start = now_seconds();
+    uint64_t expected = walk_recursive(tree->branch, work);
+    double serial = now_seconds() - start;
+
+    printf("<< %zu nodes, %u rounds of work each >>\n", count, work);
+    printf("threads      time   speedup\n");
+    printf("serial %8.1f ms\n", serial * 1e3);
+    // 1, 2, 4... threads, and always <max_threads> last even if it's not 2^n.
+    int nthreads = 1;
+    for (;;)
+    {
+        struct walk_args args = { .results = results, .work = work };
+        for (int t = 0; t < max_threads; t++)
+            results[t].sum = 0;
+
+        start = now_seconds();
+        bool ok = ws_run(nthreads, walk_task, &args, tree->branch);
+        double elapsed = now_seconds() - start;
+
+        uint64_t sum = 0;
+        for (int t = 0; t < nthreads; t++)
+            sum += results[t].sum;
+        printf("%7i %8.1f ms %8.2fx%s\n", nthreads, elapsed * 1e3,
+               serial / elapsed,
+               (!ok) ? "  (failed)" : (sum != expected) ? "  (wrong sum!)" : "");
+
+        if (nthreads == max_threads) break;
+        nthreads = (nthreads * 2 < max_threads) ? nthreads * 2 : max_threads;
+    }
+
+    bt_destroy(&tree);
+    free(values);
+    free(results);
+    return EXIT_SUCCESS;
+}